@@ -57,6 +57,8 @@ class MicroBitBLEChar
     microbit_charhandles_t  *charHandles() { return &handles; }
     
     bool cccdNotify()   { return cccd & BLE_GATT_HVX_NOTIFICATION; }
+    // BIRDBRAIN CHANGE - CCCDs are held per connection by the SoftDevice, the cached value is whichever central wrote last
+    bool cccdNotify( microbit_gaphandle_t connection);
     bool cccdIndicate() { return cccd & BLE_GATT_HVX_INDICATION; }
 
     void setCCCD(  uint16_t c) { cccd  = c; }
@@ -97,6 +97,15 @@ class MicroBitBLEService
     microbit_gaphandle_t getConnectionHandle();
     
     bool getConnected();
+
+    // BIRDBRAIN CHANGE - per connection variants for when more than one central is connected
+    bool getConnected( microbit_gaphandle_t connection);
+
+    bool notifyChrValue( int idx, microbit_gaphandle_t connection, const uint8_t *data, uint16_t length)
+    { return characteristicPtr( idx)->notifyChrValue( connection, data, length); }
+
+    bool notifyChrValueEnabled( int idx, microbit_gaphandle_t connection)
+    { return characteristicPtr( idx)->cccdNotify( connection); }
     
     bool setChrValue( int idx, const uint8_t *data, uint16_t length)
     { return characteristicPtr( idx)->setChrValue( getConnectionHandle(), data, length); }
@@ -231,6 +231,28 @@ extern uint32_t __data_end__;
 #define MICROBIT_BLE_ADVERTISING_INTERVAL        40 // BIRDBRAIN CHANGE - was 50
 #endif
 
+// BIRDBRAIN CHANGE - Two phase advertising. After boot or a disconnect we advertise every
+// MICROBIT_BLE_ADVERTISING_FAST_INTERVAL ms for MICROBIT_BLE_ADVERTISING_FAST_TIMEOUT seconds so apps find us again quickly,
+// then drop back to MICROBIT_BLE_ADVERTISING_INTERVAL to save power. Set the timeout to '0' to skip the fast phase.
+#ifndef MICROBIT_BLE_ADVERTISING_FAST_INTERVAL
+#define MICROBIT_BLE_ADVERTISING_FAST_INTERVAL   20
+#endif
+
+#ifndef MICROBIT_BLE_ADVERTISING_FAST_TIMEOUT
+#define MICROBIT_BLE_ADVERTISING_FAST_TIMEOUT    30
+#endif
+
+// BIRDBRAIN CHANGE - Manufacturer specific data carried in the scan response alongside the UART UUID.
+// The 128 bit UUID takes 18 of the 31 bytes, which leaves room for a company ID and up to 9 bytes of data.
+// 0xFFFF is the Bluetooth SIG ID reserved for testing and internal use.
+#ifndef MICROBIT_BLE_MANUFACTURER_ID
+#define MICROBIT_BLE_MANUFACTURER_ID             0xFFFF
+#endif
+
+#ifndef MICROBIT_BLE_MANUFACTURER_DATA_MAX
+#define MICROBIT_BLE_MANUFACTURER_DATA_MAX       9
+#endif
+
 // Defines default power level of the BLE radio transmitter.
 // Valid values are in the range 0..7 inclusive, with 0 being the lowest power and 7 the highest power.
 // Based on trials undertaken by the BBC, the radio is normally set to a low power level
@@ -239,6 +261,23 @@ extern uint32_t __data_end__;
 #define MICROBIT_BLE_DEFAULT_TX_POWER           6 // BIRDBRAIN CHANGE - sets this to 6 to increase power, was 1
 #endif
 
+// BIRDBRAIN CHANGE - PHY we ask for as soon as a central connects, and prefer when the central asks to change PHY.
+// Valid values are BLE_GAP_PHY_1MBPS (1) or BLE_GAP_PHY_2MBPS (2). 2M halves the airtime of every report.
+#ifndef MICROBIT_BLE_PREFERRED_PHY
+#define MICROBIT_BLE_PREFERRED_PHY              2
+#endif
+
+// BIRDBRAIN CHANGE - RSSI reporting for the link statistics. The SoftDevice only raises an event when the RSSI
+// moves by at least MICROBIT_BLE_LINK_STATS_RSSI_THRESHOLD dBm and stays there for MICROBIT_BLE_LINK_STATS_RSSI_SKIP
+// samples, which keeps the event rate low enough to leave on all the time.
+#ifndef MICROBIT_BLE_LINK_STATS_RSSI_THRESHOLD
+#define MICROBIT_BLE_LINK_STATS_RSSI_THRESHOLD  2
+#endif
+
+#ifndef MICROBIT_BLE_LINK_STATS_RSSI_SKIP
+#define MICROBIT_BLE_LINK_STATS_RSSI_SKIP       4
+#endif
+
 // Enable/Disable BLE Service: MicroBitDFU
 // This allows over the air programming during normal operation.
 // Set '1' to enable.
@@ -32,7 +32,10 @@ DEALINGS IN THE SOFTWARE.
 #define NRF52_LED_MATRIX_CLOCK_FREQUENCY        16000000            // Frequency of underlying hardware clock (must b 1MHz, 2Mhz 4Mhz, 8Mhz or 16MHz)
 #define NRF52_LED_MATRIX_FREQUENCY              60                  // Frequency of the frame update for the display
 #define NRF52_LED_MATRIX_MAXIMUM_COLUMNS        5                   // The maximum number of LEDMatrix columns supported by the hardware.
+#define NRF52_LED_MATRIX_MAXIMUM_ROWS           5                   // BIRDBRAIN CHANGE - The maximum number of LEDMatrix rows the render tables hold.
 #define NRF52_LED_MATRIX_LIGHTSENSE_STROBES     4                   // Multiple of strobe period to use for light sense
+#define NRF52_LED_MATRIX_LIGHTSENSE_FILTER      2                   // BIRDBRAIN CHANGE - Each scheduled light sample moves the level 1/4 of the way
+#define NRF52_LED_MATRIX_SCHEDULED_STROBES      1                   // BIRDBRAIN CHANGE - Multiple of strobe period for a scheduled light sense, one row's worth of dark display
 
 
 // TODO: Replace this with a resource allocated version
@@ -62,6 +65,33 @@ namespace codal
         int8_t              gpiote[NRF52_LED_MATRIX_MAXIMUM_COLUMNS];            // GPIOTE channels used by output columns.
         int8_t              ppi[NRF52_LED_MATRIX_MAXIMUM_COLUMNS];               // PPI channels used by output columns.
 
+        // BIRDBRAIN CHANGE - Timer compare values and GPIOTE configurations for each row, worked out once per change of
+        // the image rather than on every strobe. Rebuilt at the start of a frame if the image, brightness or mode changed.
+        uint32_t            rowCompare[NRF52_LED_MATRIX_MAXIMUM_ROWS][NRF52_LED_MATRIX_MAXIMUM_COLUMNS];
+        uint32_t            rowConfig[NRF52_LED_MATRIX_MAXIMUM_ROWS][NRF52_LED_MATRIX_MAXIMUM_COLUMNS];
+        uint8_t             renderedPixels[NRF52_LED_MATRIX_MAXIMUM_ROWS * NRF52_LED_MATRIX_MAXIMUM_COLUMNS];   // The image the tables were built from.
+        uint8_t             *renderedBitmap;    // The bitmap the tables were built from, in case the image has been replaced.
+        uint32_t            renderedQuantum;    // The quantum the tables were built with.
+        bool                renderedClip;       // Whether the tables were built in a black and white mode.
+        bool                tablesValid;
+
+        // BIRDBRAIN CHANGE - Back buffer that frames are composed in, copied into the image at the start of the next
+        // frame so every frame shows either all or none of an update.
+        uint8_t             backBuffer[NRF52_LED_MATRIX_MAXIMUM_ROWS * NRF52_LED_MATRIX_MAXIMUM_COLUMNS];
+        volatile bool       flipPending;        // A finished frame is waiting in the back buffer.
+
+        // BIRDBRAIN CHANGE - Light sense strobes taken every few frames instead of after every frame.
+        uint16_t            lightSenseInterval; // Frames between light sense strobes, 0 if light sensing isn't scheduled.
+        uint16_t            lightSenseFrames;   // Frames since the last light sense strobe.
+        uint16_t            lightLevelFiltered; // Smoothed light level in 1/16ths.
+        bool                lightSensePrimed;   // Whether a scheduled sample has arrived since light sensing was scheduled.
+        uint8_t             lightSenseStrobes;  // Strobe periods the light sense strobe in progress lasts.
+
+        /**
+         * BIRDBRAIN CHANGE - Rebuilds the render tables if anything they depend on has changed since they were built.
+         */
+        void updateRenderTables();
+
      
         public:
         /**
@@ -135,6 +165,29 @@ namespace codal
          */
         void clear();
 
+        /**
+         * BIRDBRAIN CHANGE - Starts composing a frame in the back buffer.
+         *
+         * The buffer holds width * height pixels in the same order as the image. It starts as a copy of what is on
+         * the display, or of the frame composed since the last flip if that hasn't been shown yet, so a frame can be
+         * built up from several writes.
+         *
+         * @return The back buffer.
+         *
+         * @code
+         * uint8_t *pixels = display.beginFrame();
+         * pixels[12] = 255;
+         * display.endFrame(); //shown from the start of the next frame
+         * @endcode
+         */
+        uint8_t *beginFrame();
+
+        /**
+         * BIRDBRAIN CHANGE - Finishes the frame in the back buffer. It is flipped into the image at the start of the
+         * next frame, and any frames finished before then are collapsed into one.
+         */
+        void endFrame();
+
         /**
          * Configures the brightness of the display.
          *
@@ -151,6 +204,23 @@ namespace codal
          */
         int readLightLevel();
 
+        /**
+         * BIRDBRAIN CHANGE - Takes a light sense strobe after every few frames, without the cost of the light sense
+         * display modes, which sense after every frame and dim the display to make room for it. While light sensing
+         * is scheduled, readLightLevel() returns a smoothed level and doesn't change the display mode.
+         *
+         * A scheduled strobe lasts one row period (about 3 ms) rather than the light sense modes' four, so the display
+         * only goes dark for that long. The level is scaled to the shorter window, so it reaches 0 in brighter light
+         * than the light sense modes do.
+         *
+         * @param frames Frames between light sense strobes, 0 to stop.
+         *
+         * @code
+         * display.setLightSenseInterval(30); //about twice a second
+         * @endcode
+         */
+        void setLightSenseInterval(uint16_t frames);
+
         /**
          * Puts the component in (or out of) sleep (low power) mode.
          */
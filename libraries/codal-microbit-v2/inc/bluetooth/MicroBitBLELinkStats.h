@@ -0,0 +1,114 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2026 BirdBrain Technologies.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  * BIRDBRAIN CHANGE - Link quality statistics for each peripheral connection.
+  *
+  * Everything here is filled in from events the SoftDevice already delivers to
+  * MicroBitBLEManager, plus the result of each notification we queue, so it costs a
+  * few counter updates per event and can be left on in production builds.
+  */
+
+#ifndef MICROBIT_BLE_LINK_STATS_H
+#define MICROBIT_BLE_LINK_STATS_H
+
+#include "MicroBitConfig.h"
+
+#if CONFIG_ENABLED(DEVICE_BLE)
+
+#include "ble.h"
+
+/**
+  * Statistics for one connection. Counters saturate rather than wrap.
+  */
+typedef struct
+{
+    uint16_t    conn_handle;            // BLE_CONN_HANDLE_INVALID if the slot is free
+    uint16_t    conn_interval;          // current connection interval in 1.25 ms units
+    uint16_t    slave_latency;          // connection events we may skip
+    uint16_t    sup_timeout;            // supervision timeout in 10 ms units
+    uint16_t    conn_param_updates;     // number of connection parameter updates since connecting
+    int8_t      rssi_last;              // most recent RSSI sample in dBm, 0 until the first sample arrives
+    int8_t      rssi_min;
+    int8_t      rssi_max;
+    int16_t     rssi_avg_x16;           // exponential moving average of the RSSI, in 1/16 dBm
+    uint16_t    rssi_samples;
+    uint8_t     tx_phy;                 // BLE_GAP_PHY_1MBPS or BLE_GAP_PHY_2MBPS
+    uint8_t     rx_phy;
+    uint16_t    max_tx_octets;          // negotiated link layer payload size (data length extension)
+    uint16_t    max_rx_octets;
+    uint32_t    hvn_queued;             // notifications accepted by the SoftDevice
+    uint32_t    hvn_complete;           // notifications reported sent by BLE_GATTS_EVT_HVN_TX_COMPLETE
+    uint32_t    hvn_queue_full;         // notifications refused because the SoftDevice queue was full
+} microbit_ble_link_stats_t;
+
+/**
+  * Totals kept across connections, so a disconnect can be diagnosed after the fact.
+  */
+typedef struct
+{
+    uint16_t    connects;
+    uint16_t    disconnects;
+    uint8_t     last_disconnect_reason; // BLE_HCI_STATUS_CODE_* of the most recent disconnect
+} microbit_ble_link_totals_t;
+
+/**
+  * Updates the statistics from a SoftDevice event. Called from the BLE event handler.
+  *
+  * @param p_ble_evt The event.
+  */
+void microbit_ble_link_stats_on_ble_evt( ble_evt_t const * p_ble_evt);
+
+/**
+  * Records the result of queueing a notification with sd_ble_gatts_hvx.
+  *
+  * @param conn_handle The connection the notification was for.
+  *
+  * @param err_code The result of sd_ble_gatts_hvx.
+  */
+void microbit_ble_link_stats_on_hvx( uint16_t conn_handle, uint32_t err_code);
+
+/**
+  * Looks up the statistics for a connection.
+  *
+  * @param conn_handle The connection.
+  *
+  * @return The statistics, or NULL if we are not tracking that connection.
+  */
+const microbit_ble_link_stats_t *microbit_ble_link_stats_get( uint16_t conn_handle);
+
+/**
+  * Adds the SoftDevice's latest RSSI measurement for a connection to its statistics.
+  *
+  * @param conn_handle The connection.
+  */
+void microbit_ble_link_stats_sample_rssi( uint16_t conn_handle);
+
+/**
+  * The totals kept across connections.
+  */
+const microbit_ble_link_totals_t *microbit_ble_link_totals_get();
+
+#endif
+#endif
@@ -39,6 +39,7 @@ DEALINGS IN THE SOFTWARE.
 #include "MicroBitDisplay.h"
 #include "ExternalEvents.h"
 #include "MicroBitButton.h"
+#include "MicroBitBLELinkStats.h" // BIRDBRAIN CHANGE
 
 
 #define MICROBIT_BLE_PAIR_REQUEST 0x01
@@ -194,16 +195,85 @@ class MicroBitBLEManager : public CodalComponent
     */
     uint32_t* configAdvertising(ManagedString deviceName);
 
+    /**
+    * BIRDBRAIN CHANGE - Changes the advertised name prefix (MB, FN or BB) in place, without stopping the advertiser.
+    * Falls back to configAdvertising if advertising has not been configured yet.
+    *
+    * @return NRF_SUCCESS, or the SoftDevice error code if the update was rejected.
+    */
+    uint32_t updateAdvertisingName(ManagedString deviceName);
+
+    /**
+    * BIRDBRAIN CHANGE - Sets the manufacturer specific data sent in the scan response, and swaps it in place if we are
+    * already advertising. Apps use it to learn about a device without connecting to it.
+    *
+    * @param data the bytes to send after the company ID, or NULL to remove the manufacturer data
+    *
+    * @param len number of bytes in data, at most MICROBIT_BLE_MANUFACTURER_DATA_MAX
+    *
+    * @return NRF_SUCCESS, NRF_ERROR_INVALID_LENGTH if len is too long, or the SoftDevice error code if the update was rejected.
+    */
+    uint32_t setAdvertisingManufacturerData(const uint8_t *data, uint8_t len);
+
     /**
 	* Stops any currently running BLE advertisements
 	*/
     void stopAdvertising();
+
+    /**
+     * BIRDBRAIN CHANGE - Whether the advertising set is running, so centrals can scan for us.
+     * Stays true after the first connection while there is room for another central.
+     */
+    bool isAdvertising();
     
     /**
      * A member function called on disconnection
      * */
     void onDisconnect();
 
+    /**
+     * BIRDBRAIN CHANGE - Sets the PHY we ask for on connection and when the central requests a PHY update.
+     * Any current connection is asked to switch straight away.
+     *
+     * @param phy BLE_GAP_PHY_1MBPS or BLE_GAP_PHY_2MBPS
+     *
+     * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the PHY is not supported.
+     */
+    int setPreferredPhy(uint8_t phy);
+
+    /**
+     * BIRDBRAIN CHANGE - The PHY we ask for on every connection (BLE_GAP_PHY_1MBPS or BLE_GAP_PHY_2MBPS)
+     */
+    uint8_t getPreferredPhy();
+
+    /**
+     * BIRDBRAIN CHANGE - Link quality statistics for one connection: connection interval, RSSI,
+     * PHY in each direction, data length and notification counts.
+     *
+     * @param connection The connection handle.
+     *
+     * @return The statistics, or NULL if there is no such connection.
+     */
+    const microbit_ble_link_stats_t *getLinkStats(microbit_gaphandle_t connection);
+
+    /**
+     * BIRDBRAIN CHANGE - Takes a fresh RSSI sample for one connection, for a link whose level hasn't moved
+     * enough to raise an RSSI event. Call before getLinkStats() when the RSSI needs to be current.
+     *
+     * @param connection The connection handle.
+     */
+    void sampleLinkRssi(microbit_gaphandle_t connection);
+
+    /**
+     * BIRDBRAIN CHANGE - Connect and disconnect totals, including the reason for the last disconnect.
+     */
+    const microbit_ble_link_totals_t *getLinkTotals();
+
+    /**
+     * BIRDBRAIN CHANGE - The number of centrals connected to us right now, from the SoftDevice's connection state.
+     */
+    uint8_t getPeripheralConnectionCount();
+
 #if CONFIG_ENABLED(MICROBIT_BLE_EDDYSTONE_URL)
     /**
       * Set the content of Eddystone URL frames
@@ -275,6 +345,7 @@ class MicroBitBLEManager : public CodalComponent
      * Control whether advertising will be restarted on disconnection
      */
     void setAdvertiseOnDisconnect( bool f) { advertiseOnDisconnect = f; }
+    bool getAdvertiseOnDisconnect() { return advertiseOnDisconnect; } // BIRDBRAIN CHANGE
     
     /**
      * Prepare for shutdown or disabling softdevice by stopping advertising and disconnecting
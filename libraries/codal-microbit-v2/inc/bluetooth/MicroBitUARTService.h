@@ -68,6 +68,12 @@ class MicroBitUARTService : public MicroBitBLEService
     uint8_t txBufferHead;
     uint8_t txBufferTail;
 
+    // BIRDBRAIN CHANGE - the central that last wrote to our RX characteristic
+    microbit_gaphandle_t lastWriteHandle;
+
+    // BIRDBRAIN CHANGE - the central that wrote each byte in rxBuffer, so bytes from two centrals are never parsed together
+    microbit_gaphandle_t* rxOwner;
+
     /**
       * A callback function for whenever a Bluetooth device consumes our TX Buffer
       */
@@ -79,6 +85,11 @@ class MicroBitUARTService : public MicroBitBLEService
       */
     void onDataWritten(const microbit_ble_evt_write_t *params);
 
+    /**
+      * BIRDBRAIN CHANGE - Records which central is writing before the data is handled by onDataWritten.
+      */
+    void onWrite(const microbit_ble_evt_t *p_ble_evt);
+
     /**
       * An internal method that copies values from a circular buffer to a linear buffer.
       *
@@ -192,6 +203,38 @@ class MicroBitUARTService : public MicroBitBLEService
       */
     int send(ManagedString s, MicroBitSerialMode mode = SYNC_SLEEP);
 
+    /**
+      * BIRDBRAIN CHANGE - Sends one notification to a particular central, without touching the TX buffer.
+      *
+      * @param connection the connection handle of the central to send to
+      * @param buf a buffer containing length number of bytes.
+      * @param length the size of the buffer, at most one notification.
+      *
+      * @return the number of bytes sent, MICROBIT_NOT_SUPPORTED if that central is not connected or has not
+      *         enabled notifications, or MICROBIT_BUSY if the SoftDevice queue for that connection is full.
+      */
+    int sendTo(microbit_gaphandle_t connection, const uint8_t *buf, int length);
+
+    /**
+      * BIRDBRAIN CHANGE - The connection handle of the central that last wrote to us, so replies can go back to it.
+      */
+    microbit_gaphandle_t getLastWriteHandle();
+
+    /**
+      * BIRDBRAIN CHANGE - The connection handle of the central that wrote the next byte getc() will return.
+      *
+      * @return the connection handle, or BLE_CONN_HANDLE_INVALID if our rxBuff is empty.
+      */
+    microbit_gaphandle_t rxNextHandle();
+
+    /**
+      * BIRDBRAIN CHANGE - The number of bytes at the front of our rxBuff written by one central, up to the first
+      * byte written by any other. Reading only these keeps each central's commands apart.
+      *
+      * @param connection the connection handle of the central, normally from rxNextHandle()
+      */
+    int rxBufferedSize(microbit_gaphandle_t connection);
+
     /**
       * Reads a number of characters from the rxBuffer and fills user given buffer.
       *
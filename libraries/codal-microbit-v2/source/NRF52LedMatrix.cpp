@@ -31,6 +31,7 @@ DEALINGS IN THE SOFTWARE.
 #include "NRF52Pin.h"
 #include "CodalDmesg.h"
 #include "ErrorNo.h"
+#include <string.h>
 
 using namespace codal;
 
@@ -60,9 +61,16 @@ NRF52LEDMatrix::NRF52LEDMatrix(NRFLowLevelTimer &displayTimer, const MatrixMap &
     instance = this;
     lightLevel = 0;
     this->mode = mode;
+    tablesValid = false;
+    flipPending = false;
+    lightSenseInterval = 0;
+    lightSenseFrames = 0;
+    lightLevelFiltered = 0;
+    lightSensePrimed = false;
+    lightSenseStrobes = NRF52_LED_MATRIX_LIGHTSENSE_STROBES;
 
     // Validate that we can deliver the requested display.
-    if (matrixMap.columns <= NRF52_LED_MATRIX_MAXIMUM_COLUMNS)
+    if (matrixMap.columns <= NRF52_LED_MATRIX_MAXIMUM_COLUMNS && matrixMap.rows <= NRF52_LED_MATRIX_MAXIMUM_ROWS && width * height <= (int)sizeof(renderedPixels))
     {
         // Configure as a fixed period timer
         timer.setMode(TimerMode::TimerModeTimer);
@@ -191,13 +199,54 @@ void NRF52LEDMatrix::disable()
 }
 
 /**
- * Configure the next frame to be drawn.
+ * BIRDBRAIN CHANGE - Rebuilds the render tables if anything they depend on has changed since they were built.
+ *
+ * Called from the display interrupt at the start of each frame. An unchanged image costs one comparison of the
+ * pixel buffer, rather than a map lookup, multiply and GPIOTE read-modify-write for every pixel of every strobe.
  */
-void NRF52LEDMatrix::render()
+void NRF52LEDMatrix::updateRenderTables()
 {
     uint8_t *screenBuffer = image.getBitmap();
-    uint32_t value;
+    bool clip = (mode == DISPLAY_MODE_BLACK_AND_WHITE || mode == DISPLAY_MODE_BLACK_AND_WHITE_LIGHT_SENSE);
+    int pixels = width * height;
+
+    if (tablesValid && screenBuffer == renderedBitmap && quantum == renderedQuantum && clip == renderedClip && memcmp(screenBuffer, renderedPixels, pixels) == 0)
+        return;
+
+    for (int row = 0; row < matrixMap.rows; row++)
+    {
+        MatrixPoint *p = (MatrixPoint *)matrixMap.map + row;
+
+        for (int column = 0; column < matrixMap.columns; column++)
+        {
+            uint32_t value = screenBuffer[p->y * width + p->x];
+
+            // Clip pixels to full or zero brightness if in black and white mode.
+            if (clip)
+                value = value ? 255 : 0;
+
+            value = value * quantum;
+            rowCompare[row][column] = value;
+
+            // Set the initial polarity of the column output to HIGH if the pixel brightness is >0. LOW otherwise.
+            rowConfig[row][column] = 0x00010003 | (matrixMap.columnPins[column]->name << 8) | (value ? 0 : 0x00100000);
+
+            p += matrixMap.rows;
+        }
+    }
+
+    memcpy(renderedPixels, screenBuffer, pixels);
+    renderedBitmap = screenBuffer;
+    renderedQuantum = quantum;
+    renderedClip = clip;
+    tablesValid = true;
+}
 
+/**
+ * Configure the next frame to be drawn.
+ */
+void NRF52LEDMatrix::render()
+{
     if (strobeRow < matrixMap.rows)
     {
         // We just completed a normal diplay strobe. 
@@ -207,7 +256,16 @@ void NRF52LEDMatrix::render()
     else
     {
         // We just completed a light sense strobe. Record the light level sensed.
-        lightLevel = 255 - ((255 * timer.timer->CC[1]) / (timerPeriod * NRF52_LED_MATRIX_LIGHTSENSE_STROBES));
+        lightLevel = 255 - ((255 * timer.timer->CC[1]) / (timerPeriod * lightSenseStrobes)); // BIRDBRAIN CHANGE - scheduled strobes are shorter
+
+        // BIRDBRAIN CHANGE - Scheduled samples are sparse, so smooth them. The first one sets the level outright.
+        if (lightSenseInterval && lightSensePrimed)
+            lightLevelFiltered += ((int32_t)(lightLevel << 4) - (int32_t)lightLevelFiltered) >> NRF52_LED_MATRIX_LIGHTSENSE_FILTER;
+        else if (lightSenseInterval)
+        {
+            lightLevelFiltered = lightLevel << 4;
+            lightSensePrimed = true;
+        }
         
         // Restore the hardware configuration into LED drive mode.
         status |= NRF52_LEDMATRIX_STATUS_RESET;
@@ -217,32 +275,40 @@ void NRF52LEDMatrix::render()
     // Stop the timer temporarily, to avoid possible race conditions.
     timer.timer->TASKS_STOP = 1;
 
-    // Move on to the next row.
-    strobeRow = (strobeRow + 1) % timeslots;
+    // BIRDBRAIN CHANGE - Move on to the next row. After the last row, take a light sense strobe if we are in a
+    // light sense mode, or if a scheduled one is due.
+    if (strobeRow + 1 < matrixMap.rows)
+    {
+        strobeRow++;
+    }
+    else if (strobeRow < matrixMap.rows && (timeslots > matrixMap.rows || (lightSenseInterval && ++lightSenseFrames >= lightSenseInterval)))
+    {
+        strobeRow = matrixMap.rows;
+        lightSenseFrames = 0;
+    }
+    else
+    {
+        strobeRow = 0;
+    }
 
     if(strobeRow < matrixMap.rows)
     {
-        // Common case - configure timer values.
-        MatrixPoint *p = (MatrixPoint *)matrixMap.map + strobeRow;
+        // BIRDBRAIN CHANGE - Common case - copy in the timer values and column polarities worked out for this row.
+        // A new frame starts with the latest finished frame from the back buffer.
+        if (strobeRow == 0)
+        {
+            if (flipPending)
+            {
+                memcpy(image.getBitmap(), backBuffer, width * height);
+                flipPending = false;
+            }
+            updateRenderTables();
+        }
 
         for (int column = 0; column < matrixMap.columns; column++)
         {
-            value = screenBuffer[p->y * width + p->x];
-
-            // Clip pixels to full or zero brightness if in black and white mode.
-            if (mode == DISPLAY_MODE_BLACK_AND_WHITE || mode == DISPLAY_MODE_BLACK_AND_WHITE_LIGHT_SENSE)
-                value = value ? 255 : 0;
-
-            value = value * quantum;
-            timer.timer->CC[column+1] = value;
-
-            // Set the initial polarity of the column output to HIGH if the pixel brightness is >0. LOW otherwise.
-            if (value)
-                NRF_GPIOTE->CONFIG[gpiote[column]] &= ~0x00100000;
-            else
-                NRF_GPIOTE->CONFIG[gpiote[column]] |= 0x00100000;
-            
-            p += matrixMap.rows;
+            timer.timer->CC[column+1] = rowCompare[strobeRow][column];
+            NRF_GPIOTE->CONFIG[gpiote[column]] = rowConfig[strobeRow][column];
         }
 
         // Enable the drive pin, and start the timer.
@@ -254,14 +320,17 @@ void NRF52LEDMatrix::render()
         // sense and capture the voltage on the LED rows, rather than drive them.
         
         // Extend the refresh period to allow for reasonable accuracy.
-        timer.setCompare(0, timerPeriod * NRF52_LED_MATRIX_LIGHTSENSE_STROBES);
+        // BIRDBRAIN CHANGE - Scheduled strobes keep the display dark for less time, as the light sense modes
+        // already dim the display but we don't.
+        lightSenseStrobes = (timeslots > matrixMap.rows) ? NRF52_LED_MATRIX_LIGHTSENSE_STROBES : NRF52_LED_MATRIX_SCHEDULED_STROBES;
+        timer.setCompare(0, timerPeriod * lightSenseStrobes);
        
         // Disable GPIOTE control on the columns pins, and set all column pins to HIGH.
         // n.b. we don't use GPIOTE to do this drive as we need to reuse the channels anyway...
         for (int column = 0; column < matrixMap.columns; column++)
         {
             NRF_GPIOTE->CONFIG[gpiote[column]] = 0;
-            timer.timer->CC[column+1] = timerPeriod * NRF52_LED_MATRIX_LIGHTSENSE_STROBES;
+            timer.timer->CC[column+1] = timerPeriod * lightSenseStrobes;
             matrixMap.columnPins[column]->setDigitalValue(1);
         }
 
@@ -289,9 +358,48 @@ void NRF52LEDMatrix::render()
   */
 void NRF52LEDMatrix::clear()
 {
+    // BIRDBRAIN CHANGE - A clear replaces any frame still waiting to be shown
+    flipPending = false;
     image.clear();
 }
 
+/**
+ * BIRDBRAIN CHANGE - Starts composing a frame in the back buffer.
+ *
+ * The buffer holds width * height pixels in the same order as the image. It starts as a copy of what is on
+ * the display, or of the frame composed since the last flip if that hasn't been shown yet, so a frame can be
+ * built up from several writes.
+ *
+ * @return The back buffer.
+ */
+uint8_t *NRF52LEDMatrix::beginFrame()
+{
+    // The render interrupt only reads the back buffer while a flip is pending, so holding the flip back
+    // lets us write to it safely. The interrupt can't preempt itself, so it can't be half way through a copy here.
+    if (flipPending)
+        flipPending = false;
+    else
+        memcpy(backBuffer, image.getBitmap(), width * height);
+
+    return backBuffer;
+}
+
+/**
+ * BIRDBRAIN CHANGE - Finishes the frame in the back buffer. It is flipped into the image at the start of the
+ * next frame, and any frames finished before then are collapsed into one.
+ */
+void NRF52LEDMatrix::endFrame()
+{
+    // Nothing will flip the frame for us while the display is off
+    if (!enabled)
+    {
+        memcpy(image.getBitmap(), backBuffer, width * height);
+        return;
+    }
+
+    flipPending = true;
+}
+
 /**
  * Configures the brightness of the display.
  *
@@ -322,6 +430,10 @@ NRF52LEDMatrix::readLightLevel()
 {
     bool modeChanged = false;
 
+    // BIRDBRAIN CHANGE - Light sensing on a schedule gives a smoothed level without changing mode
+    if (lightSenseInterval)
+        return lightLevelFiltered >> 4;
+
     // Auto-enable light sensing if it is currently disabled
     if (mode == DisplayMode::DISPLAY_MODE_BLACK_AND_WHITE)
     {
@@ -342,6 +454,21 @@ NRF52LEDMatrix::readLightLevel()
     return lightLevel;
 }
 
+/**
+ * BIRDBRAIN CHANGE - Takes a light sense strobe after every few frames, without the cost of the light sense
+ * display modes, which sense after every frame and dim the display to make room for it.
+ *
+ * @param frames Frames between light sense strobes, 0 to stop.
+ */
+void NRF52LEDMatrix::setLightSenseInterval(uint16_t frames)
+{
+    if (frames && !lightSenseInterval)
+        lightSensePrimed = false;
+
+    lightSenseFrames = 0;
+    lightSenseInterval = frames;
+}
+
 /**
  * Puts the component in (or out of) sleep (low power) mode.
  */
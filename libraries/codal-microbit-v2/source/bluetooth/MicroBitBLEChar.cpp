@@ -34,6 +34,7 @@ DEALINGS IN THE SOFTWARE.
 
 #include "MicroBitBLEServices.h"
 #include "MicroBitBLEChar.h"
+#include "MicroBitBLELinkStats.h" // BIRDBRAIN CHANGE
 
 #include "ble.h"
 #include "ble_srv_common.h"
@@ -60,6 +61,25 @@ bool MicroBitBLEChar::setChrValue( microbit_gaphandle_t connection, const uint8_
 }
 
 
+// BIRDBRAIN CHANGE - reads the CCCD the given central has written from the SoftDevice
+bool MicroBitBLEChar::cccdNotify( microbit_gaphandle_t connection)
+{
+    if ( connection == BLE_CONN_HANDLE_INVALID || handles.cccd == BLE_GATT_HANDLE_INVALID)
+        return false;
+
+    uint8_t cccd_value[ BLE_CCCD_VALUE_LEN];
+    ble_gatts_value_t value;
+    value.len     = sizeof( cccd_value);
+    value.offset  = 0;
+    value.p_value = cccd_value;
+
+    if ( sd_ble_gatts_value_get( connection, handles.cccd, &value) != NRF_SUCCESS)
+        return false;
+
+    return uint16_decode( cccd_value) & BLE_GATT_HVX_NOTIFICATION;
+}
+
+
 bool MicroBitBLEChar::notifyChrValue( microbit_gaphandle_t connection, const uint8_t *data, uint16_t length)
 {
     if ( connection == BLE_CONN_HANDLE_INVALID)
@@ -69,7 +89,7 @@ bool MicroBitBLEChar::notifyChrValue( microbit_gaphandle_t connection, const uin
     
     bool set = false;
     
-    if ( cccdNotify())
+    if ( cccdNotify( connection)) // BIRDBRAIN CHANGE - check this connection, not whichever central wrote the CCCD last
     {
         ble_gatts_hvx_params_t hvx_params;
         hvx_params.handle = handles.value;
@@ -81,7 +101,10 @@ bool MicroBitBLEChar::notifyChrValue( microbit_gaphandle_t connection, const uin
         MICROBIT_DEBUG_DMESGF( "calling sd_ble_gatts_hvx( %d, %x, %d, %d)",
                (int) handles.value, (unsigned int) data, (int) *data, (int) length);
         
-        if ( MICROBIT_BLE_ECHK( sd_ble_gatts_hvx( connection, &hvx_params)) == NRF_SUCCESS)
+        // BIRDBRAIN CHANGE - count queued and refused notifications for the link statistics
+        uint32_t err_code = MICROBIT_BLE_ECHK( sd_ble_gatts_hvx( connection, &hvx_params));
+        microbit_ble_link_stats_on_hvx( connection, err_code);
+        if ( err_code == NRF_SUCCESS)
             return true;
         
         if ( *hvx_params.p_len == length)
@@ -0,0 +1,290 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2026 BirdBrain Technologies.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  * BIRDBRAIN CHANGE - Link quality statistics for each peripheral connection.
+  */
+
+#include "MicroBitConfig.h"
+
+#if CONFIG_ENABLED(DEVICE_BLE)
+
+#include "MicroBitBLETypes.h"
+#include "MicroBitBLELinkStats.h"
+
+#include "ble.h"
+#include "ble_gap.h"
+#include "ble_hci.h"
+#include "nrf_sdh_ble.h"
+
+#include <string.h>
+
+#define MICROBIT_BLE_LINK_STATS_SLOTS   NRF_SDH_BLE_TOTAL_LINK_COUNT
+
+static microbit_ble_link_stats_t    m_link_stats[ MICROBIT_BLE_LINK_STATS_SLOTS];
+static microbit_ble_link_totals_t   m_link_totals;
+static bool                         m_link_stats_init = false;
+
+
+static void microbit_ble_link_stats_reset( microbit_ble_link_stats_t *stats, uint16_t conn_handle)
+{
+    memset( stats, 0, sizeof( microbit_ble_link_stats_t));
+    stats->conn_handle   = conn_handle;
+    stats->tx_phy        = BLE_GAP_PHY_1MBPS;
+    stats->rx_phy        = BLE_GAP_PHY_1MBPS;
+    stats->max_tx_octets = BLE_GAP_DATA_LENGTH_DEFAULT;
+    stats->max_rx_octets = BLE_GAP_DATA_LENGTH_DEFAULT;
+}
+
+
+static microbit_ble_link_stats_t *microbit_ble_link_stats_find( uint16_t conn_handle)
+{
+    if ( !m_link_stats_init || conn_handle == BLE_CONN_HANDLE_INVALID)
+        return NULL;
+
+    for ( int i = 0; i < MICROBIT_BLE_LINK_STATS_SLOTS; i++)
+    {
+        if ( m_link_stats[i].conn_handle == conn_handle)
+            return &m_link_stats[i];
+    }
+
+    return NULL;
+}
+
+
+static void microbit_ble_link_stats_set_conn_params( microbit_ble_link_stats_t *stats, ble_gap_conn_params_t const *params)
+{
+    stats->conn_interval = params->max_conn_interval;   // min == max once the link is up
+    stats->slave_latency = params->slave_latency;
+    stats->sup_timeout   = params->conn_sup_timeout;
+}
+
+
+static void microbit_ble_link_stats_rssi( microbit_ble_link_stats_t *stats, int8_t rssi)
+{
+    // An RSSI of 0 or above is the "not available" value, not a real sample
+    if ( rssi >= 0)
+        return;
+
+    if ( stats->rssi_samples == 0)
+    {
+        stats->rssi_min     = rssi;
+        stats->rssi_max     = rssi;
+        stats->rssi_avg_x16 = rssi * 16;
+    }
+    else
+    {
+        if ( rssi < stats->rssi_min) stats->rssi_min = rssi;
+        if ( rssi > stats->rssi_max) stats->rssi_max = rssi;
+
+        // alpha = 1/8
+        stats->rssi_avg_x16 += ( rssi * 16 - stats->rssi_avg_x16) / 8;
+    }
+
+    stats->rssi_last = rssi;
+    if ( stats->rssi_samples < 0xFFFF)
+        stats->rssi_samples++;
+}
+
+
+/**
+  * Updates the statistics from a SoftDevice event. Called from the BLE event handler.
+  *
+  * @param p_ble_evt The event.
+  */
+void microbit_ble_link_stats_on_ble_evt( ble_evt_t const * p_ble_evt)
+{
+    if ( !m_link_stats_init)
+    {
+        for ( int i = 0; i < MICROBIT_BLE_LINK_STATS_SLOTS; i++)
+            m_link_stats[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+        m_link_stats_init = true;
+    }
+
+    switch ( p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            uint16_t conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            microbit_ble_link_stats_t *stats = microbit_ble_link_stats_find( conn_handle);
+
+            for ( int i = 0; stats == NULL && i < MICROBIT_BLE_LINK_STATS_SLOTS; i++)
+            {
+                if ( m_link_stats[i].conn_handle == BLE_CONN_HANDLE_INVALID)
+                    stats = &m_link_stats[i];
+            }
+
+            if ( m_link_totals.connects < 0xFFFF)
+                m_link_totals.connects++;
+
+            if ( stats == NULL)
+                break;
+
+            microbit_ble_link_stats_reset( stats, conn_handle);
+            microbit_ble_link_stats_set_conn_params( stats, &p_ble_evt->evt.gap_evt.params.connected.conn_params);
+
+            // Only report RSSI changes bigger than the threshold, and only once they have held for a few
+            // connection events, so a noisy room doesn't flood us with events
+            MICROBIT_BLE_ECHK( sd_ble_gap_rssi_start( conn_handle, MICROBIT_BLE_LINK_STATS_RSSI_THRESHOLD, MICROBIT_BLE_LINK_STATS_RSSI_SKIP));
+            break;
+        }
+
+        case BLE_GAP_EVT_DISCONNECTED:
+        {
+            m_link_totals.last_disconnect_reason = p_ble_evt->evt.gap_evt.params.disconnected.reason;
+            if ( m_link_totals.disconnects < 0xFFFF)
+                m_link_totals.disconnects++;
+
+            microbit_ble_link_stats_t *stats = microbit_ble_link_stats_find( p_ble_evt->evt.gap_evt.conn_handle);
+            if ( stats)
+                stats->conn_handle = BLE_CONN_HANDLE_INVALID;
+            break;
+        }
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+        {
+            microbit_ble_link_stats_t *stats = microbit_ble_link_stats_find( p_ble_evt->evt.gap_evt.conn_handle);
+            if ( stats)
+            {
+                microbit_ble_link_stats_set_conn_params( stats, &p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params);
+                if ( stats->conn_param_updates < 0xFFFF)
+                    stats->conn_param_updates++;
+            }
+            break;
+        }
+
+        case BLE_GAP_EVT_RSSI_CHANGED:
+        {
+            microbit_ble_link_stats_t *stats = microbit_ble_link_stats_find( p_ble_evt->evt.gap_evt.conn_handle);
+            if ( stats)
+                microbit_ble_link_stats_rssi( stats, p_ble_evt->evt.gap_evt.params.rssi_changed.rssi);
+            break;
+        }
+
+        case BLE_GAP_EVT_PHY_UPDATE:
+        {
+            microbit_ble_link_stats_t *stats = microbit_ble_link_stats_find( p_ble_evt->evt.gap_evt.conn_handle);
+            if ( stats && p_ble_evt->evt.gap_evt.params.phy_update.status == BLE_HCI_STATUS_CODE_SUCCESS)
+            {
+                stats->tx_phy = p_ble_evt->evt.gap_evt.params.phy_update.tx_phy;
+                stats->rx_phy = p_ble_evt->evt.gap_evt.params.phy_update.rx_phy;
+            }
+            break;
+        }
+
+        case BLE_GAP_EVT_DATA_LENGTH_UPDATE:
+        {
+            microbit_ble_link_stats_t *stats = microbit_ble_link_stats_find( p_ble_evt->evt.gap_evt.conn_handle);
+            if ( stats)
+            {
+                stats->max_tx_octets = p_ble_evt->evt.gap_evt.params.data_length_update.effective_params.max_tx_octets;
+                stats->max_rx_octets = p_ble_evt->evt.gap_evt.params.data_length_update.effective_params.max_rx_octets;
+            }
+            break;
+        }
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        {
+            microbit_ble_link_stats_t *stats = microbit_ble_link_stats_find( p_ble_evt->evt.gatts_evt.conn_handle);
+            if ( stats)
+            {
+                uint32_t count = p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count;
+                stats->hvn_complete = ( stats->hvn_complete > 0xFFFFFFFF - count) ? 0xFFFFFFFF : stats->hvn_complete + count;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+
+/**
+  * Records the result of queueing a notification with sd_ble_gatts_hvx.
+  *
+  * @param conn_handle The connection the notification was for.
+  *
+  * @param err_code The result of sd_ble_gatts_hvx.
+  */
+void microbit_ble_link_stats_on_hvx( uint16_t conn_handle, uint32_t err_code)
+{
+    microbit_ble_link_stats_t *stats = microbit_ble_link_stats_find( conn_handle);
+    if ( stats == NULL)
+        return;
+
+    if ( err_code == NRF_SUCCESS)
+    {
+        if ( stats->hvn_queued < 0xFFFFFFFF)
+            stats->hvn_queued++;
+    }
+    else if ( err_code == NRF_ERROR_RESOURCES)
+    {
+        if ( stats->hvn_queue_full < 0xFFFFFFFF)
+            stats->hvn_queue_full++;
+    }
+}
+
+
+/**
+  * Looks up the statistics for a connection.
+  *
+  * @param conn_handle The connection.
+  *
+  * @return The statistics, or NULL if we are not tracking that connection.
+  */
+const microbit_ble_link_stats_t *microbit_ble_link_stats_get( uint16_t conn_handle)
+{
+    return microbit_ble_link_stats_find( conn_handle);
+}
+
+
+/**
+  * Adds the SoftDevice's latest RSSI measurement for a connection to its statistics.
+  * RSSI events only arrive when the level moves, so this gives a fresh sample for a link that has been steady.
+  *
+  * @param conn_handle The connection.
+  */
+void microbit_ble_link_stats_sample_rssi( uint16_t conn_handle)
+{
+    microbit_ble_link_stats_t *stats = microbit_ble_link_stats_find( conn_handle);
+    if ( stats == NULL)
+        return;
+
+    int8_t  rssi;
+    uint8_t ch_index;
+    if ( sd_ble_gap_rssi_get( conn_handle, &rssi, &ch_index) == NRF_SUCCESS)
+        microbit_ble_link_stats_rssi( stats, rssi);
+}
+
+
+/**
+  * The totals kept across connections.
+  */
+const microbit_ble_link_totals_t *microbit_ble_link_totals_get()
+{
+    return &m_link_totals;
+}
+
+#endif
@@ -77,6 +77,7 @@ DEALINGS IN THE SOFTWARE.
 // BIRDBRAIN CHANGE - Adding uart service to make registration possible
 #include "MicroBitUARTService.h"
 #include "ble_gap.h" // BIRDBRAIN CHANGE - For getting the mac address during naming
+#include "MicroBitBLELinkStats.h" // BIRDBRAIN CHANGE
 
 #define MICROBIT_PAIRING_FADE_SPEED 4
 
@@ -136,6 +137,9 @@ static int                  m_power         = MICROBIT_BLE_DEFAULT_TX_POWER;
 static uint8_t              m_adv_handle    = BLE_GAP_ADV_SET_HANDLE_NOT_SET;
 static volatile int         m_pending;
 
+// BIRDBRAIN CHANGE - PHY negotiation state
+static uint8_t              m_phy_preferred = MICROBIT_BLE_PREFERRED_PHY;
+
 // BIRDBRAIN CHANGE
 static uint8_t              m_enc_advdata[ BLE_GAP_ADV_SET_DATA_SIZE_MAX];
 static uint8_t              m_enc_srdata[ BLE_GAP_ADV_SET_DATA_SIZE_MAX];
@@ -177,6 +181,38 @@ static ble_gap_adv_data_t gap_adv_data_bb =
     }
 };
 
+// BIRDBRAIN CHANGE - Second set of buffers so the name can be swapped while advertising. The SoftDevice keeps using
+// the buffers it was last given, so each update must be encoded into the set that is not currently in use.
+static uint8_t              m_enc_advdata_bb2[ BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+static uint8_t              m_enc_srdata_bb2[ BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+
+static ble_gap_adv_data_t gap_adv_data_bb2 =
+{
+    .adv_data =
+    {
+        .p_data = m_enc_advdata_bb2,
+        .len    = BLE_GAP_ADV_SET_DATA_SIZE_MAX
+    },
+    .scan_rsp_data =
+    {
+        .p_data = m_enc_srdata_bb2,
+        .len    = BLE_GAP_ADV_SET_DATA_SIZE_MAX
+
+    }
+};
+
+static ble_gap_adv_data_t  *m_adv_data_bb_active = NULL;
+
+// BIRDBRAIN CHANGE - true while in the fast phase of the BirdBrain advertising schedule
+static bool                 m_adv_fast_bb = false;
+
+// BIRDBRAIN CHANGE - true while the advertising set is running, in either phase
+static bool                 m_advertising = false;
+
+// BIRDBRAIN CHANGE - manufacturer specific data for the BirdBrain scan response
+static uint8_t              m_manuf_data_bb[ MICROBIT_BLE_MANUFACTURER_DATA_MAX];
+static uint8_t              m_manuf_data_bb_len = 0;
+
 
 NRF_BLE_GATT_DEF( m_gatt);
 
@@ -185,6 +221,14 @@ NRF_BLE_GATT_DEF( m_gatt);
 
 static void microbit_ble_for_each_connected_disconnect( uint16_t conn_handle, void *p_context);
 static void microbit_ble_for_each_connected_tx_power_set( uint16_t conn_handle, void *p_context);
+static void microbit_ble_for_each_connected_phy_update( uint16_t conn_handle, void *p_context);
+
+static void microbit_ble_set_device_name_bb( ManagedString prefix);
+static uint32_t microbit_ble_encode_advdata_bb( ble_gap_adv_data_t *p_adv_data);
+static uint32_t microbit_ble_encode_srdata_bb( ble_gap_adv_data_t *p_adv_data);
+static uint32_t microbit_ble_swap_advdata_bb();
+static void microbit_ble_adv_params_bb( ble_gap_adv_params_t *p_params, bool fast);
+static uint32_t microbit_ble_adv_phase_bb( bool fast);
 
 static void bleConnectionCallback( microbit_gaphandle_t handle);
 static void passkeyDisplayCallback( microbit_gaphandle_t handle, ManagedString passKey);
@@ -725,7 +769,10 @@ void MicroBitBLEManager::idleCallback()
 void MicroBitBLEManager::advertise()
 {
     MICROBIT_DEBUG_DMESG( "advertise");
-    MICROBIT_BLE_ECHK( sd_ble_gap_adv_start( m_adv_handle, microbit_ble_CONN_CFG_TAG));
+    uint32_t err = sd_ble_gap_adv_start( m_adv_handle, microbit_ble_CONN_CFG_TAG);
+    MICROBIT_BLE_ECHK( err);
+    if ( err == NRF_SUCCESS)
+        m_advertising = true; // BIRDBRAIN CHANGE
 }
 
 
@@ -736,6 +783,15 @@ void MicroBitBLEManager::stopAdvertising()
 {
     MICROBIT_DEBUG_DMESG( "stopAdvertising");
     MICROBIT_BLE_ECHK( sd_ble_gap_adv_stop( m_adv_handle));
+    m_advertising = false; // BIRDBRAIN CHANGE
+}
+
+/**
+ * BIRDBRAIN CHANGE - Whether the advertising set is running, so centrals can scan for us
+ */
+bool MicroBitBLEManager::isAdvertising()
+{
+    return m_advertising;
 }
 
 
@@ -759,40 +815,16 @@ char convert_ascii(uint8_t input)
 	return output;
 }
 
-/** 
- * BIRDBRAIN CHANGE - Configures advertising between stop and start
- * This could be extended to pass parameters, but for now just uses what we need
- * Essentially, it changes the advertising data to add the UART, and also allows us to dynamically update the device name
- */
-uint32_t* MicroBitBLEManager::configAdvertising(ManagedString deviceName)
+// BIRDBRAIN CHANGE - Sets the GAP device name to the two character prefix followed by the last five digits of the MAC address
+static void microbit_ble_set_device_name_bb( ManagedString prefix)
 {
-
-    static uint32_t err_codes[4]; // Returns all four error codes of BLE functions called here - needed this while debugging, not needed in production
-
     // Pointer to security mode, used by sd_ble_gap_device_name_set
     ble_gap_conn_sec_mode_t sec_mode;
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
 
-    // Getting the special name using the micro:bit's serial number. This could be changed to the mac address if needed
-    /*ManagedString gapName;
-    // Get the serial number
-    uint32_t sn = microbit_serial_number();
-
-    // Convert the serial number to a string
-    char buffer[9];
-    sprintf(buffer,"%lX",sn); //buffer now contains sn as a null terminated string
-    ManagedString serialNumberAsHex(buffer);
-    uint8_t serial_length = serialNumberAsHex.length();
-
-    // Put together the device Name (MB, BB, or FN) with the last five digits of the serial number
-	gapName = gapName + deviceName + serialNumberAsHex.substring(serial_length-5,serial_length); 
-    // Setting the device name
-    err_codes[3] = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)gapName.toCharArray(), gapName.length());
-    */
-    // Set the name using the mac address
     char deviceNameArray[8];
-    deviceNameArray[0] = deviceName.charAt(0);
-    deviceNameArray[1] = deviceName.charAt(1);
+    deviceNameArray[0] = prefix.charAt(0);
+    deviceNameArray[1] = prefix.charAt(1);
 	ble_gap_addr_t 					mac;
     sd_ble_gap_addr_get(&mac);
 
@@ -810,8 +842,12 @@ uint32_t* MicroBitBLEManager::configAdvertising(ManagedString deviceName)
 	deviceNameArray[6] = convert_ascii(mac.addr[0]&0x0F);
 	deviceNameArray[7] = '\0';
     sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)deviceNameArray, strlen(deviceNameArray));
+}
 
-
+// BIRDBRAIN CHANGE - Encodes the BirdBrain advertising packet (flags + full name) into p_adv_data
+static uint32_t microbit_ble_encode_advdata_bb( ble_gap_adv_data_t *p_adv_data)
+{
+    uint32_t err;
 
     ble_advdata_t advdata; // Struct to hold the advertising data
 
@@ -819,6 +855,19 @@ uint32_t* MicroBitBLEManager::configAdvertising(ManagedString deviceName)
     advdata.name_type = BLE_ADVDATA_FULL_NAME; // Send the full device name in the advertising packet
     advdata.flags     = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE; 
 
+    // The encoder treats len as the space available, so reset it each time
+    p_adv_data->adv_data.len = BLE_GAP_ADV_SET_DATA_SIZE_MAX;
+
+    err = ble_advdata_encode( &advdata, p_adv_data->adv_data.p_data, &p_adv_data->adv_data.len);
+    NRF_LOG_HEXDUMP_INFO( p_adv_data->adv_data.p_data, p_adv_data->adv_data.len);
+    return err;
+}
+
+// BIRDBRAIN CHANGE - Encodes the BirdBrain scan response (UART UUID + device state) into p_adv_data
+static uint32_t microbit_ble_encode_srdata_bb( ble_gap_adv_data_t *p_adv_data)
+{
+    uint32_t err;
+
     ble_advdata_t srdata; // Hold the scan response data packet for advertising
     memset(&srdata, 0, sizeof(srdata));
     ble_uuid_t adv_uuids[] = {UART_SERVICE_ID, 0x02}; // Type is 0x02 - VENDOR BEGIN, since we use a 128 bit UUID
@@ -826,31 +875,182 @@ uint32_t* MicroBitBLEManager::configAdvertising(ManagedString deviceName)
     srdata.uuids_complete.p_uuids = adv_uuids; // Set the UUID to the location of the 128 bit UUID
     srdata.name_type             = BLE_ADVDATA_NO_NAME; // Full name is advertised in the adv packet, don't advertise it in scan response
 
-    // Now set up the advertising parameters. This is essentially the same settings as in the vanilla configureAdvertising function, with connectable
+    // Device state for apps to read from scan results, in the space left after the UUID
+    ble_advdata_manuf_data_t manuf;
+    if ( m_manuf_data_bb_len > 0)
+    {
+        manuf.company_identifier = MICROBIT_BLE_MANUFACTURER_ID;
+        manuf.data.p_data        = m_manuf_data_bb;
+        manuf.data.size          = m_manuf_data_bb_len;
+        srdata.p_manuf_specific_data = &manuf;
+    }
+
+    // The encoder treats len as the space available, so reset it each time
+    p_adv_data->scan_rsp_data.len = BLE_GAP_ADV_SET_DATA_SIZE_MAX;
+
+    err = ble_advdata_encode( &srdata, p_adv_data->scan_rsp_data.p_data, &p_adv_data->scan_rsp_data.len);
+    NRF_LOG_HEXDUMP_INFO( p_adv_data->scan_rsp_data.p_data, p_adv_data->scan_rsp_data.len);
+    return err;
+}
+
+// BIRDBRAIN CHANGE - Fills in the BirdBrain advertising parameters for the fast or slow phase of the schedule
+static void microbit_ble_adv_params_bb( ble_gap_adv_params_t *p_params, bool fast)
+{
+    // Essentially the same settings as in the vanilla configureAdvertising function, with connectable
     // and scannable set to true, whitelisting/pairing set to false
+    memset( p_params, 0, sizeof( ble_gap_adv_params_t));
+    p_params->properties.type  = BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED;
+    p_params->interval         = ( 1000 * ( fast ? MICROBIT_BLE_ADVERTISING_FAST_INTERVAL : MICROBIT_BLE_ADVERTISING_INTERVAL)) / 625;  // 625 us units
+    if ( p_params->interval < BLE_GAP_ADV_INTERVAL_MIN) p_params->interval = BLE_GAP_ADV_INTERVAL_MIN;
+    if ( p_params->interval > BLE_GAP_ADV_INTERVAL_MAX) p_params->interval = BLE_GAP_ADV_INTERVAL_MAX;
+    // The fast phase times out and BLE_GAP_EVT_ADV_SET_TERMINATED moves us to the slow phase, which never times out
+    p_params->duration         = fast ? MICROBIT_BLE_ADVERTISING_FAST_TIMEOUT * 100 : 0;  // 10 ms units
+    p_params->filter_policy    = BLE_GAP_ADV_FP_ANY;
+    p_params->primary_phy      = BLE_GAP_PHY_1MBPS;
+}
+
+// BIRDBRAIN CHANGE - Switches the BirdBrain advertising set to the fast or slow phase, keeping the current data.
+// Parameters can only change while the advertiser is stopped.
+static uint32_t microbit_ble_adv_phase_bb( bool fast)
+{
+    if ( m_adv_data_bb_active == NULL)
+        return NRF_ERROR_INVALID_STATE;
+
+    ble_gap_adv_params_t gap_adv_params;
+    microbit_ble_adv_params_bb( &gap_adv_params, fast && MICROBIT_BLE_ADVERTISING_FAST_TIMEOUT > 0);
+
+    MICROBIT_DEBUG_DMESG( "microbit_ble_adv_phase_bb fast %d", (int) fast);
+    uint32_t err = sd_ble_gap_adv_set_configure( &m_adv_handle, m_adv_data_bb_active, &gap_adv_params);
+    if ( err == NRF_SUCCESS)
+        m_adv_fast_bb = fast;
+    return err;
+}
+
+/** 
+ * BIRDBRAIN CHANGE - Configures advertising between stop and start
+ * This could be extended to pass parameters, but for now just uses what we need
+ * Essentially, it changes the advertising data to add the UART, and also allows us to dynamically update the device name
+ */
+uint32_t* MicroBitBLEManager::configAdvertising(ManagedString deviceName)
+{
+
+    static uint32_t err_codes[4]; // Returns all four error codes of BLE functions called here - needed this while debugging, not needed in production
+
+    // Getting the special name using the micro:bit's serial number. This could be changed to the mac address if needed
+    /*ManagedString gapName;
+    // Get the serial number
+    uint32_t sn = microbit_serial_number();
+
+    // Convert the serial number to a string
+    char buffer[9];
+    sprintf(buffer,"%lX",sn); //buffer now contains sn as a null terminated string
+    ManagedString serialNumberAsHex(buffer);
+    uint8_t serial_length = serialNumberAsHex.length();
+
+    // Put together the device Name (MB, BB, or FN) with the last five digits of the serial number
+	gapName = gapName + deviceName + serialNumberAsHex.substring(serial_length-5,serial_length); 
+    // Setting the device name
+    err_codes[3] = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)gapName.toCharArray(), gapName.length());
+    */
+    // Set the name using the mac address
+    microbit_ble_set_device_name_bb( deviceName);
+
+    // Now set up the advertising parameters, starting with the fast phase of the schedule
     ble_gap_adv_params_t    gap_adv_params;
-    memset( &gap_adv_params, 0, sizeof( gap_adv_params));
-    gap_adv_params.properties.type  = BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED;
-    gap_adv_params.interval         = ( 1000 * MICROBIT_BLE_ADVERTISING_INTERVAL) / 625;  // 625 us units
-    if ( gap_adv_params.interval < BLE_GAP_ADV_INTERVAL_MIN) gap_adv_params.interval = BLE_GAP_ADV_INTERVAL_MIN;
-    if ( gap_adv_params.interval > BLE_GAP_ADV_INTERVAL_MAX) gap_adv_params.interval = BLE_GAP_ADV_INTERVAL_MAX;
-    gap_adv_params.duration         = 0; // BIRDBRAIN CHANGE: never time out  old code: timeout_seconds * 100;              //10 ms units
-    gap_adv_params.filter_policy    = BLE_GAP_ADV_FP_ANY;
-    gap_adv_params.primary_phy      = BLE_GAP_PHY_1MBPS;
+    microbit_ble_adv_params_bb( &gap_adv_params, MICROBIT_BLE_ADVERTISING_FAST_TIMEOUT > 0);
 
     // Encoding the advertising data into our gap_adv_data struct
-    err_codes[0]= ble_advdata_encode( &advdata, gap_adv_data_bb.adv_data.p_data, &gap_adv_data_bb.adv_data.len);
-    NRF_LOG_HEXDUMP_INFO( gap_adv_data_bb.adv_data.p_data, gap_adv_data_bb.adv_data.len);
+    err_codes[0]= microbit_ble_encode_advdata_bb( &gap_adv_data_bb);
     // Adding Scan Response data to gap_adv_data
-    err_codes[1]= ble_advdata_encode( &srdata, gap_adv_data_bb.scan_rsp_data.p_data, &gap_adv_data_bb.scan_rsp_data.len);
-    NRF_LOG_HEXDUMP_INFO( gap_adv_data_bb.scan_rsp_data.p_data, gap_adv_data_bb.scan_rsp_data.len);
+    err_codes[1]= microbit_ble_encode_srdata_bb( &gap_adv_data_bb);
     // Finally, configuring advertising data
     err_codes[2]= sd_ble_gap_adv_set_configure( &m_adv_handle, &gap_adv_data_bb, &gap_adv_params);
+    m_adv_data_bb_active = &gap_adv_data_bb;
+    m_adv_fast_bb = true;
 
     return err_codes;
 } 
 
 
+/**
+ * BIRDBRAIN CHANGE - Changes the advertised name prefix without stopping the advertiser.
+ * The new name is encoded into the buffers the SoftDevice is not using and handed over in one call, so we stay
+ * discoverable throughout and the new name goes out from the next advertising event.
+ *
+ * @param deviceName the two character prefix (MB, FN or BB), followed in the name by the last five digits of the MAC address
+ *
+ * @return NRF_SUCCESS, or the SoftDevice error code if the update was rejected.
+ */
+uint32_t MicroBitBLEManager::updateAdvertisingName(ManagedString deviceName)
+{
+    // Nothing configured yet, so there is nothing to swap - just do the full configuration
+    if ( m_adv_handle == BLE_GAP_ADV_SET_HANDLE_NOT_SET || m_adv_data_bb_active == NULL)
+        return configAdvertising( deviceName)[2];
+
+    MICROBIT_DEBUG_DMESG( "updateAdvertisingName");
+
+    microbit_ble_set_device_name_bb( deviceName);
+
+    return microbit_ble_swap_advdata_bb();
+}
+
+
+/**
+ * BIRDBRAIN CHANGE - Sets the manufacturer specific data sent in the scan response, and swaps it in place if we are
+ * already advertising.
+ *
+ * @param data the bytes to send after the company ID, or NULL to remove the manufacturer data
+ *
+ * @param len number of bytes in data, at most MICROBIT_BLE_MANUFACTURER_DATA_MAX
+ *
+ * @return NRF_SUCCESS, NRF_ERROR_INVALID_LENGTH if len is too long, or the SoftDevice error code if the update was rejected.
+ */
+uint32_t MicroBitBLEManager::setAdvertisingManufacturerData(const uint8_t *data, uint8_t len)
+{
+    if ( len > MICROBIT_BLE_MANUFACTURER_DATA_MAX)
+        return NRF_ERROR_INVALID_LENGTH;
+
+    if ( data == NULL)
+        len = 0;
+
+    // Nothing to do if it hasn't changed, so we don't churn the SoftDevice on every refresh
+    if ( len == m_manuf_data_bb_len && ( len == 0 || memcmp( m_manuf_data_bb, data, len) == 0))
+        return NRF_SUCCESS;
+
+    if ( len > 0)
+        memcpy( m_manuf_data_bb, data, len);
+    m_manuf_data_bb_len = len;
+
+    // Picked up by configAdvertising if we haven't started advertising yet
+    if ( m_adv_handle == BLE_GAP_ADV_SET_HANDLE_NOT_SET || m_adv_data_bb_active == NULL)
+        return NRF_SUCCESS;
+
+    return microbit_ble_swap_advdata_bb();
+}
+
+
+// BIRDBRAIN CHANGE - Encodes the BirdBrain advertising data into the buffers the SoftDevice is not using and hands them over.
+// Parameters must be NULL when changing data on an advertising set that may be running.
+static uint32_t microbit_ble_swap_advdata_bb()
+{
+    ble_gap_adv_data_t *next = m_adv_data_bb_active == &gap_adv_data_bb ? &gap_adv_data_bb2 : &gap_adv_data_bb;
+
+    uint32_t err = microbit_ble_encode_advdata_bb( next);
+    if ( err != NRF_SUCCESS)
+        return err;
+
+    err = microbit_ble_encode_srdata_bb( next);
+    if ( err != NRF_SUCCESS)
+        return err;
+
+    err = sd_ble_gap_adv_set_configure( &m_adv_handle, next, NULL);
+    if ( err == NRF_SUCCESS)
+        m_adv_data_bb_active = next;
+
+    return err;
+}
+
+
 /**
  * A member function used to restart advertising
  * */
@@ -860,8 +1060,84 @@ void MicroBitBLEManager::onDisconnect()
         
     MicroBitEvent(MICROBIT_ID_BLE, MICROBIT_BLE_EVT_DISCONNECTED);
     
-    if ( advertiseOnDisconnect && ble_conn_state_peripheral_conn_count() == 0)
-        advertise();
+    // BIRDBRAIN CHANGE - every link that frees up gets the fast phase, so the app that just lost us can find us again
+    // quickly. The advertising set may still be running slowly for the other link, and can only change phase while stopped
+    if ( advertiseOnDisconnect && ble_conn_state_peripheral_conn_count() < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
+    {
+        if ( m_adv_data_bb_active != NULL && !m_adv_fast_bb)
+        {
+            if ( m_advertising)
+            {
+                MICROBIT_BLE_ECHK( sd_ble_gap_adv_stop( m_adv_handle));
+                m_advertising = false;
+            }
+            MICROBIT_BLE_ECHK( microbit_ble_adv_phase_bb( true));
+        }
+        if ( !m_advertising)
+            advertise();
+    }
+}
+
+/**
+ * BIRDBRAIN CHANGE - Sets the PHY we ask for on connection and when the central requests a PHY update.
+ * Any current connection is asked to switch straight away.
+ *
+ * @param phy BLE_GAP_PHY_1MBPS or BLE_GAP_PHY_2MBPS
+ *
+ * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the PHY is not supported.
+ */
+int MicroBitBLEManager::setPreferredPhy(uint8_t phy)
+{
+    if ( phy != BLE_GAP_PHY_1MBPS && phy != BLE_GAP_PHY_2MBPS)
+        return DEVICE_INVALID_PARAMETER;
+
+    MICROBIT_DEBUG_DMESG( "setPreferredPhy %d", (int) phy);
+
+    m_phy_preferred = phy;
+
+    ble_conn_state_for_each_connected( microbit_ble_for_each_connected_phy_update, NULL);
+
+    return DEVICE_OK;
+}
+
+/**
+ * BIRDBRAIN CHANGE - The PHY we ask for on every connection (BLE_GAP_PHY_1MBPS or BLE_GAP_PHY_2MBPS)
+ */
+uint8_t MicroBitBLEManager::getPreferredPhy()
+{
+    return m_phy_preferred;
+}
+
+/**
+ * BIRDBRAIN CHANGE - Link quality statistics for one connection
+ */
+const microbit_ble_link_stats_t *MicroBitBLEManager::getLinkStats(microbit_gaphandle_t connection)
+{
+    return microbit_ble_link_stats_get( connection);
+}
+
+/**
+ * BIRDBRAIN CHANGE - Takes a fresh RSSI sample for one connection
+ */
+void MicroBitBLEManager::sampleLinkRssi(microbit_gaphandle_t connection)
+{
+    microbit_ble_link_stats_sample_rssi( connection);
+}
+
+/**
+ * BIRDBRAIN CHANGE - Connect and disconnect totals, including the reason for the last disconnect
+ */
+const microbit_ble_link_totals_t *MicroBitBLEManager::getLinkTotals()
+{
+    return microbit_ble_link_totals_get();
+}
+
+/**
+ * BIRDBRAIN CHANGE - The number of centrals connected to us right now
+ */
+uint8_t MicroBitBLEManager::getPeripheralConnectionCount()
+{
+    return ble_conn_state_peripheral_conn_count();
 }
 
 
@@ -1221,6 +1497,7 @@ bool MicroBitBLEManager::prepareForShutdown()
     bool shutdownOK = true;
         
     sd_ble_gap_adv_stop( m_adv_handle);
+    m_advertising = false; // BIRDBRAIN CHANGE
     setAdvertiseOnDisconnect( false);
 
     if ( ble_conn_state_conn_count()) // TODO: anything else we need to wait for?
@@ -1336,6 +1613,7 @@ static void microbit_ble_configureAdvertising( bool connectable, bool discoverab
     MICROBIT_BLE_ECHK( ble_advdata_encode( p_srdata, gap_adv_data.scan_rsp_data.p_data, &gap_adv_data.scan_rsp_data.len));
     NRF_LOG_HEXDUMP_INFO( gap_adv_data.scan_rsp_data.p_data, gap_adv_data.scan_rsp_data.len);
     MICROBIT_BLE_ECHK( sd_ble_gap_adv_set_configure( &m_adv_handle, &gap_adv_data, &gap_adv_params));
+    m_adv_data_bb_active = NULL; // BIRDBRAIN CHANGE - no longer using the BirdBrain advertising set
 }
 
 static void microbit_ble_configureAdvertising( bool connectable, bool discoverable, bool whitelist,
@@ -1429,6 +1707,8 @@ static void microbit_ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_conte
 {
     //MICROBIT_DEBUG_DMESG( "%d:microbit_ble_evt_handler %x %d", (int)system_timer_current_time(), (unsigned int) p_ble_evt->header.evt_id);
     
+    microbit_ble_link_stats_on_ble_evt( p_ble_evt); // BIRDBRAIN CHANGE
+
     switch (p_ble_evt->header.evt_id)
     {
         case BLE_GAP_EVT_DISCONNECTED:
@@ -1440,19 +1720,56 @@ static void microbit_ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_conte
         case BLE_GAP_EVT_CONNECTED:
         {
             MICROBIT_DEBUG_DMESG( "BLE_GAP_EVT_CONNECTED %d", ble_conn_state_conn_count());
+            // BIRDBRAIN CHANGE - a connection on our connectable advertising set stops it
+            if ( p_ble_evt->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_PERIPH)
+                m_advertising = false;
+            // BIRDBRAIN CHANGE - every link starts on 1M, ask for our preferred PHY straight away rather than waiting for the central
+            if ( m_phy_preferred != BLE_GAP_PHY_1MBPS)
+                microbit_ble_for_each_connected_phy_update( p_ble_evt->evt.gap_evt.conn_handle, NULL);
             bleConnectionCallback( p_ble_evt->evt.gap_evt.conn_handle);
+            // BIRDBRAIN CHANGE - keep advertising while there is room for another central, e.g. a teacher dashboard
+            if ( p_ble_evt->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_PERIPH
+                 && ble_conn_state_peripheral_conn_count() < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT
+                 && MicroBitBLEManager::manager && MicroBitBLEManager::manager->getAdvertiseOnDisconnect())
+                MicroBitBLEManager::manager->advertise();
             break;
         }
-        case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
+        case BLE_GAP_EVT_ADV_SET_TERMINATED:
         {
-            ble_gap_phys_t const phys =
+            // BIRDBRAIN CHANGE - the fast phase has run its course, carry on advertising slowly
+            MICROBIT_DEBUG_DMESG( "BLE_GAP_EVT_ADV_SET_TERMINATED reason %d", (int) p_ble_evt->evt.gap_evt.params.adv_set_terminated.reason);
+            m_advertising = false;
+            if ( p_ble_evt->evt.gap_evt.params.adv_set_terminated.reason == BLE_GAP_EVT_ADV_SET_TERMINATED_REASON_TIMEOUT
+                 && m_adv_data_bb_active != NULL && m_adv_fast_bb
+                 && ble_conn_state_peripheral_conn_count() < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
             {
-                .tx_phys = BLE_GAP_PHY_AUTO,
-                .rx_phys = BLE_GAP_PHY_AUTO,
-            };
+                MICROBIT_BLE_ECHK( microbit_ble_adv_phase_bb( false));
+                uint32_t err = sd_ble_gap_adv_start( m_adv_handle, microbit_ble_CONN_CFG_TAG);
+                MICROBIT_BLE_ECHK( err);
+                m_advertising = ( err == NRF_SUCCESS);
+            }
+            break;
+        }
+        case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
+        {
+            // BIRDBRAIN CHANGE - accept what the central asked for as well as our preferred PHY, so a central that
+            // wants 1M (or a PHY we don't prefer) isn't refused. On connect we still ask for our preferred PHY ourselves
+            ble_gap_phys_t const *peer = &p_ble_evt->evt.gap_evt.params.phy_update_request.peer_preferred_phys;
+            ble_gap_phys_t phys;
+            phys.tx_phys = m_phy_preferred | peer->tx_phys;
+            phys.rx_phys = m_phy_preferred | peer->rx_phys;
+            MICROBIT_DEBUG_DMESG( "BLE_GAP_EVT_PHY_UPDATE_REQUEST peer tx %d rx %d", (int) peer->tx_phys, (int) peer->rx_phys);
             MICROBIT_BLE_ECHK( sd_ble_gap_phy_update( p_ble_evt->evt.gap_evt.conn_handle, &phys));
             break;
         }
+        case BLE_GAP_EVT_PHY_UPDATE:
+        {
+            // BIRDBRAIN CHANGE - the PHY each link settled on is kept in its link stats
+            ble_gap_evt_phy_update_t const *phy_update = &p_ble_evt->evt.gap_evt.params.phy_update;
+            MICROBIT_DEBUG_DMESG( "BLE_GAP_EVT_PHY_UPDATE status %d tx %d rx %d preferred %d",
+                                  (int) phy_update->status, (int) phy_update->tx_phy, (int) phy_update->rx_phy, (int) m_phy_preferred);
+            break;
+        }
         case BLE_GAP_EVT_PASSKEY_DISPLAY:
         {
             ManagedString passKey( (const char *)p_ble_evt->evt.gap_evt.params.passkey_display.passkey, BLE_GAP_PASSKEY_LEN);
@@ -1574,6 +1891,17 @@ static void microbit_ble_for_each_connected_tx_power_set( uint16_t conn_handle,
 }
 
 
+// BIRDBRAIN CHANGE - asks the link to move to our preferred PHY. Also used to answer a PHY update request from the central
+static void microbit_ble_for_each_connected_phy_update( uint16_t conn_handle, void * /*p_context*/)
+{
+    ble_gap_phys_t phys;
+    phys.tx_phys = m_phy_preferred;
+    phys.rx_phys = m_phy_preferred;
+    MICROBIT_DEBUG_DMESGF( "microbit_ble_for_each_connected_phy_update conn_handle %d phy %d", (int) conn_handle, (int) m_phy_preferred);
+    MICROBIT_BLE_ECHK( sd_ble_gap_phy_update( conn_handle, &phys));
+}
+
+
 /**
  * Callback for handling shutdown preparation.
  *
@@ -1649,6 +1977,7 @@ static bool microbit_ble_sdh_req_handler(nrf_sdh_req_evt_t req, void * /*p_conte
             else
             {
                 sd_ble_gap_adv_stop( m_adv_handle);
+                m_advertising = false; // BIRDBRAIN CHANGE
                 if ( ble_conn_state_conn_count()) // TODO: anything else we need to wait for?
                 {
                     changeOK = false;
@@ -156,6 +156,13 @@ bool MicroBitBLEService::getConnected()
     return ble_conn_state_peripheral_conn_count() > 0;
 }
 
+
+// BIRDBRAIN CHANGE - whether a particular central is still connected
+bool MicroBitBLEService::getConnected( microbit_gaphandle_t connection)
+{
+    return ble_conn_state_status( connection) == BLE_CONN_STATUS_CONNECTED;
+}
+
                                             
 int MicroBitBLEService::charHandleToIdx( uint16_t handle, microbit_charattr_t *type)
 {
@@ -191,8 +198,10 @@ bool MicroBitBLEService::onBleEvent( microbit_ble_evt_t const * p_ble_evt)
           //TODO: clear handle and connected flag?
           onDisconnect( p_ble_evt);
 
-          for ( int idx = 0; idx < characteristicCount(); idx++)
-              characteristicPtr( idx)->setCCCD(0);
+          // BIRDBRAIN CHANGE - another central may still be connected and using the cached CCCDs
+          if ( ble_conn_state_peripheral_conn_count() == 0)
+              for ( int idx = 0; idx < characteristicCount(); idx++)
+                  characteristicPtr( idx)->setCCCD(0);
           break;
 
       case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
@@ -69,6 +69,7 @@ MicroBitUARTService::MicroBitUARTService(BLEDevice &_ble, uint8_t rxBufferSize,
 
     txBuffer = (uint8_t *)malloc(txBufferSize);
     rxBuffer = (uint8_t *)malloc(rxBufferSize);
+    rxOwner = (microbit_gaphandle_t *)malloc(rxBufferSize * sizeof(microbit_gaphandle_t)); // BIRDBRAIN CHANGE
 
     rxBufferHead = 20; // start the pointers one 20 byte packet in to prevent overwriting
     rxBufferTail = 20; // in truth, I do not know why this seems to work, but it does
@@ -80,6 +81,8 @@ MicroBitUARTService::MicroBitUARTService(BLEDevice &_ble, uint8_t rxBufferSize,
 
     writingToBuffer = false;
 
+    lastWriteHandle = BLE_CONN_HANDLE_INVALID;
+
     // Register the base UUID and create the service.
     RegisterBaseUUID( base_uuid);
     CreateService( serviceUUID);
@@ -112,6 +115,18 @@ void MicroBitUARTService::onConfirmation( const microbit_ble_evt_hvc_t *params)
 }
 
 
+/**
+  * BIRDBRAIN CHANGE - Records which central is writing before the data is handled by onDataWritten.
+  */
+void MicroBitUARTService::onWrite(const microbit_ble_evt_t *p_ble_evt)
+{
+    if ( p_ble_evt->evt.gatts_evt.params.write.handle == valueHandle( mbbs_cIdxRX))
+        lastWriteHandle = p_ble_evt->evt.gatts_evt.conn_handle;
+
+    MicroBitBLEService::onWrite( p_ble_evt);
+}
+
+
 /**
   * A callback function for whenever a Bluetooth device writes to our RX characteristic.
   */
@@ -167,6 +182,7 @@ void MicroBitUARTService::onDataWritten(const microbit_ble_evt_write_t *params)
 
                 }*/
                 rxBuffer[rxBufferHead] = c;
+                rxOwner[rxBufferHead] = lastWriteHandle; // BIRDBRAIN CHANGE - onWrite has just recorded the writer
 
                 rxBufferHead = newHead;
 
@@ -386,6 +402,71 @@ int MicroBitUARTService::send(ManagedString s, MicroBitSerialMode mode)
     return send((uint8_t *)s.toCharArray(), s.length(), mode);
 }
 
+/**
+  * BIRDBRAIN CHANGE - Sends one notification to a particular central, without touching the TX buffer.
+  *
+  * @param connection the connection handle of the central to send to
+  * @param buf a buffer containing length number of bytes.
+  * @param length the size of the buffer, at most one notification.
+  *
+  * @return the number of bytes sent, MICROBIT_NOT_SUPPORTED if that central is not connected or has not
+  *         enabled notifications, or MICROBIT_BUSY if the SoftDevice queue for that connection is full.
+  */
+int MicroBitUARTService::sendTo(microbit_gaphandle_t connection, const uint8_t *buf, int length)
+{
+    if(length < 1 || length > txBufferSize - 1)
+        return MICROBIT_INVALID_PARAMETER;
+
+    if(!getConnected(connection) || !notifyChrValueEnabled(mbbs_cIdxTX, connection))
+        return MICROBIT_NOT_SUPPORTED;
+
+    if(!notifyChrValue(mbbs_cIdxTX, connection, buf, length))
+        return MICROBIT_BUSY;
+
+    return length;
+}
+
+/**
+  * BIRDBRAIN CHANGE - The connection handle of the central that last wrote to us, so replies can go back to it.
+  */
+microbit_gaphandle_t MicroBitUARTService::getLastWriteHandle()
+{
+    return lastWriteHandle;
+}
+
+/**
+  * BIRDBRAIN CHANGE - The connection handle of the central that wrote the next byte getc() will return.
+  *
+  * @return the connection handle, or BLE_CONN_HANDLE_INVALID if our rxBuff is empty.
+  */
+microbit_gaphandle_t MicroBitUARTService::rxNextHandle()
+{
+    if(!isReadable())
+        return BLE_CONN_HANDLE_INVALID;
+
+    return rxOwner[rxBufferTail];
+}
+
+/**
+  * BIRDBRAIN CHANGE - The number of bytes at the front of our rxBuff written by one central, up to the first
+  * byte written by any other.
+  *
+  * @param connection the connection handle of the central, normally from rxNextHandle()
+  */
+int MicroBitUARTService::rxBufferedSize(microbit_gaphandle_t connection)
+{
+    int count = 0;
+    uint16_t position = rxBufferTail;
+
+    while(position != rxBufferHead && rxOwner[position] == connection)
+    {
+        count++;
+        position = (position + 1) % rxBufferSize;
+    }
+
+    return count;
+}
+
 /**
   * Reads a number of characters from the rxBuffer and fills user given buffer.
   *
@@ -0,0 +1,46 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "ActuatorCache.h"
+
+typedef struct {
+    bool valid;                                   // false until a frame has been written, or after an invalidate
+    uint8_t length;
+    uint32_t lastWrite;                           // system time the frame was last sent
+    uint8_t frame[CACHE_FRAME_LENGTH];
+} CacheSlot;
+
+static CacheSlot slots[CACHE_SLOTS];
+
+void actuatorCacheInvalidate()
+{
+    for(int i = 0; i < CACHE_SLOTS; i++)
+        slots[i].valid = false;
+}
+
+void actuatorCacheInvalidate(uint8_t slot)
+{
+    if(slot < CACHE_SLOTS)
+        slots[slot].valid = false;
+}
+
+// Android sends setAll as fast as it can whether or not anything changed, so most frames in steady state are repeats
+bool actuatorCacheUpdate(uint8_t slot, const uint8_t* frame, uint8_t length)
+{
+    if(slot >= CACHE_SLOTS || length > CACHE_FRAME_LENGTH)
+        return true;
+
+    CacheSlot *cached = &slots[slot];
+    uint32_t now = uBit.systemTime();
+
+    if(cached->valid && cached->length == length && (now - cached->lastWrite) < ACTUATOR_REFRESH_PERIOD
+        && memcmp(cached->frame, frame, length) == 0)
+    {
+        return false;
+    }
+
+    memcpy(cached->frame, frame, length);
+    cached->length = length;
+    cached->lastWrite = now;
+    cached->valid = true;
+    return true;
+}
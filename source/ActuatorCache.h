@@ -0,0 +1,19 @@
+#ifndef ACTUATORCACHE_H
+#define ACTUATORCACHE_H
+
+#include "BirdBrain.h"
+
+// Each kind of output frame we send over SPI gets its own slot, the SAMD keeps them separately
+#define CACHE_FINCH_LEDS                          0 // setAllFinchLEDs
+#define CACHE_FINCH_MOTORS                        1 // moveMotor, only continuous speeds, a tick count is a new move every time
+#define CACHE_HB_OUTPUTS                          2 // setAllHB
+#define CACHE_SLOTS                               3
+
+#define CACHE_FRAME_LENGTH                        16 // longest frame we cache
+#define ACTUATOR_REFRESH_PERIOD                   500 // ms, an identical frame is sent anyway after this in case the SAMD reset under us
+
+void actuatorCacheInvalidate(); // Forgets every slot, so the next frame of each kind goes out. Use after anything that changes the outputs behind the cache's back
+void actuatorCacheInvalidate(uint8_t slot);
+bool actuatorCacheUpdate(uint8_t slot, const uint8_t* frame, uint8_t length); // Returns true if the frame needs writing, and remembers it as written
+
+#endif
@@ -0,0 +1,220 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "Animation.h"
+
+static AnimationFrame ring[ANIM_RING_LENGTH];
+static uint8_t head = 0; // oldest frame
+static uint8_t count = 0; // frames in the ring
+static uint8_t position = 0; // frame being shown, counted from head
+static int8_t step = 1; // +1 or -1 while ping-ponging
+static uint8_t mode = ANIM_ONCE;
+static uint8_t animationId = 0;
+static uint16_t animationLink = BLE_CONN_HANDLE_INVALID; // app that started playback, gets the notifications
+static bool playing = false;
+static bool listening = false;
+static uint32_t nextDue = 0; // when the frame being shown is over
+static DisplayMode savedMode = DISPLAY_MODE_BLACK_AND_WHITE; // display mode to go back to once playback stops
+
+static void notify(uint16_t link, uint8_t event)
+{
+    if(!bleuart->getConnected(link))
+        return;
+    uint8_t report[ANIM_REPORT_LENGTH];
+    report[0] = MB_ANIMATION;
+    report[1] = event;
+    report[2] = animationId;
+    report[3] = count;
+    bleLinkSend(link, report, ANIM_REPORT_LENGTH);
+}
+
+// Unpacks a frame straight into the display's back buffer, 4 bit levels spread over 0-255
+static void showFrame(AnimationFrame *frame)
+{
+    uint8_t *pixels = uBit.display.beginFrame();
+    for(int i = 0; i < SYMBOL_PIXELS; i++)
+    {
+        uint8_t level = (i & 1) ? (frame->pixels[i/2] & 0x0F) : (frame->pixels[i/2] >> 4);
+        pixels[i] = level * 17;
+    }
+    uBit.display.endFrame();
+}
+
+// Greyscale needs the display in a greyscale mode, keeping light sensing on if it was
+static void greyscaleDisplay()
+{
+    savedMode = uBit.display.getDisplayMode();
+    if(savedMode == DISPLAY_MODE_BLACK_AND_WHITE)
+        uBit.display.setDisplayMode(DISPLAY_MODE_GREYSCALE);
+    else if(savedMode == DISPLAY_MODE_BLACK_AND_WHITE_LIGHT_SENSE)
+        uBit.display.setDisplayMode(DISPLAY_MODE_GREYSCALE_LIGHT_SENSE);
+}
+
+static void restoreDisplay()
+{
+    uBit.display.setDisplayMode(savedMode);
+}
+
+static void schedule(uint32_t due)
+{
+    nextDue = due;
+    system_timer_event_after(due - uBit.systemTime(), BB_ID, ANIM_FRAME_EVT);
+}
+
+// Works out the next frame to show, returns false once a once-through animation has run out
+static bool advance()
+{
+    switch(mode)
+    {
+        case ANIM_ONCE:
+            // The frame we just showed is used up
+            head = (head + 1) % ANIM_RING_LENGTH;
+            count--;
+            return count > 0;
+        case ANIM_LOOP:
+            position = (position + 1) % count;
+            return true;
+        default:
+            if(count > 1)
+            {
+                if((step > 0 && position == count - 1) || (step < 0 && position == 0))
+                    step = -step;
+                position += step;
+            }
+            return true;
+    }
+}
+
+// Timer event for the end of a frame. Events from before a stop or restart arrive early for the new schedule and are ignored
+static void animationTick(MicroBitEvent)
+{
+    uint32_t now = uBit.systemTime();
+    if(!playing || (int32_t)(now - nextDue) < 0)
+        return;
+
+    if(!advance())
+    {
+        animationStop();
+        notify(animationLink, ANIM_DONE);
+        return;
+    }
+
+    AnimationFrame *frame = &ring[(head + position) % ANIM_RING_LENGTH];
+    showFrame(frame);
+    // Each frame starts when the last was due to end, not when we got round to it, so the animation doesn't drift.
+    // If we fell a whole frame behind, start counting again from now
+    uint32_t due = nextDue + frame->duration;
+    if((int32_t)(due - now) <= 0)
+        due = now + frame->duration;
+    schedule(due);
+}
+
+// A full ring is reported to the app that sent the frame, the app that started playback keeps its notifications
+static void addFrame(uint16_t duration, const uint8_t *pixels, bool grey, uint16_t link)
+{
+    if(count >= ANIM_RING_LENGTH)
+    {
+        notify(link, ANIM_FULL);
+        return;
+    }
+
+    AnimationFrame *frame = &ring[(head + count) % ANIM_RING_LENGTH];
+    frame->duration = (duration < ANIM_MIN_DURATION) ? ANIM_MIN_DURATION : duration;
+    if(grey)
+    {
+        memcpy(frame->pixels, pixels, ANIM_PIXEL_BYTES);
+    }
+    else
+    {
+        uint32_t bits = ((uint32_t)pixels[0]<<24) | ((uint32_t)pixels[1]<<16) | ((uint32_t)pixels[2]<<8) | pixels[3];
+        memset(frame->pixels, 0, ANIM_PIXEL_BYTES);
+        for(int i = 0; i < SYMBOL_PIXELS; i++)
+        {
+            if(bits & (1UL << i))
+                frame->pixels[i/2] |= (i & 1) ? 0x0F : 0xF0;
+        }
+    }
+    count++;
+}
+
+static void play(uint8_t playMode, uint8_t id, uint16_t link)
+{
+    if(!listening)
+    {
+        uBit.messageBus.listen(BB_ID, ANIM_FRAME_EVT, animationTick);
+        listening = true;
+    }
+
+    if(playing)
+        animationStop();
+    animationId = id;
+    animationLink = link;
+    if(count == 0)
+    {
+        notify(animationLink, ANIM_DONE);
+        return;
+    }
+
+    flashOn = false; // the animation takes over the display from any message
+    mode = (playMode <= ANIM_PINGPONG) ? playMode : ANIM_ONCE;
+    position = 0;
+    step = 1;
+    playing = true;
+    greyscaleDisplay();
+    showFrame(&ring[head]);
+    schedule(uBit.systemTime() + ring[head].duration);
+}
+
+uint8_t animationCommandLength(uint8_t op)
+{
+    switch(op)
+    {
+        case ANIM_FRAME:
+            return ANIM_FRAME_LENGTH;
+        case ANIM_FRAME_GREY:
+            return ANIM_FRAME_GREY_LENGTH;
+        case ANIM_PLAY:
+            return ANIM_PLAY_LENGTH;
+        default:
+            return ANIM_CLEAR_LENGTH;
+    }
+}
+
+void animationCommand(uint8_t commands[], uint8_t length, uint16_t link)
+{
+    if(length < 2 || length < animationCommandLength(commands[1]))
+        return;
+
+    switch(commands[1])
+    {
+        case ANIM_CLEAR:
+            animationStop();
+            head = 0;
+            count = 0;
+            break;
+        case ANIM_FRAME:
+            addFrame((commands[2] << 8) | commands[3], &commands[4], false, link);
+            break;
+        case ANIM_FRAME_GREY:
+            addFrame((commands[2] << 8) | commands[3], &commands[4], true, link);
+            break;
+        case ANIM_PLAY:
+            play(commands[2], commands[3], link);
+            break;
+        case ANIM_STOP:
+            animationStop();
+            break;
+    }
+}
+
+void animationStop()
+{
+    if(!playing)
+        return;
+    playing = false;
+    restoreDisplay();
+}
+
+bool animationPlaying()
+{
+    return playing;
+}
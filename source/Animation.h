@@ -0,0 +1,43 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "BirdBrain.h"
+
+// MB_ANIMATION commands, the second byte is the operation. Durations are ms, MSB first
+#define ANIM_CLEAR                                0x00 // [MB_ANIMATION, ANIM_CLEAR], stops playback and forgets the frames
+#define ANIM_FRAME                                0x01 // [MB_ANIMATION, ANIM_FRAME, duration (2 bytes), symbol (4 bytes)], on/off pixels packed as in the SYMBOL command
+#define ANIM_FRAME_GREY                           0x02 // [MB_ANIMATION, ANIM_FRAME_GREY, duration (2 bytes), pixels (13 bytes)], 4 bits a pixel, first pixel in the high nibble
+#define ANIM_PLAY                                 0x03 // [MB_ANIMATION, ANIM_PLAY, mode, id]
+#define ANIM_STOP                                 0x04 // [MB_ANIMATION, ANIM_STOP], stops playback and keeps the frames
+
+#define ANIM_CLEAR_LENGTH                         2
+#define ANIM_FRAME_LENGTH                         8
+#define ANIM_FRAME_GREY_LENGTH                    17
+#define ANIM_PLAY_LENGTH                          4
+#define ANIM_STOP_LENGTH                          2
+
+// Playback modes
+#define ANIM_ONCE                                 0x00 // frames are used up as they are shown, so an app can keep adding frames while we play
+#define ANIM_LOOP                                 0x01
+#define ANIM_PINGPONG                             0x02 // forwards then backwards, without showing the end frames twice
+
+// Notifications: [MB_ANIMATION, event, id, frames in the ring]
+#define ANIM_REPORT_LENGTH                        4
+#define ANIM_DONE                                 0x01 // a once-through animation ran out of frames
+#define ANIM_FULL                                 0x02 // the frame was dropped
+
+#define ANIM_RING_LENGTH                          24
+#define ANIM_PIXEL_BYTES                          13 // 25 pixels at 4 bits each
+#define ANIM_MIN_DURATION                         10 // ms, shorter frames are stretched to this
+
+typedef struct {
+    uint16_t duration;
+    uint8_t pixels[ANIM_PIXEL_BYTES];
+} AnimationFrame;
+
+uint8_t animationCommandLength(uint8_t op); // Bytes an MB_ANIMATION command with this operation takes, 2 if we don't know it
+void animationCommand(uint8_t commands[], uint8_t length, uint16_t link); // Decodes an MB_ANIMATION command
+void animationStop(); // Stops playback where it is, e.g. because the app drew on the display itself
+bool animationPlaying();
+
+#endif
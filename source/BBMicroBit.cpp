@@ -4,173 +4,59 @@
 #include "BBMicroBit.h"
 #include "BLESerial.h"
 
-char messageFlash[18]; // 18 is the maximum message length
-uint8_t messageLength; 
 bool flashOn;  // Allows us to cancel flashing a message if we're asked to print a symbol before we're done
-bool newFlash; // Flag to show if a new message needs to update the message being flashed
 bool pinsInputs[3]; // Determines if pins 0, 1, and 2 are set as inputs
 
-uint16_t buzzPeriod;
-uint16_t buzzDuration;
-bool newBuzz; // Flag to show if a new buzzer value needs to update the buzzer
-bool buzzerRunning; // Flag to capture if the buzzer event is currently running 
-
 // helper function to convert the accelerometer value from milli-gs to an 8-bit val
 uint8_t convertAccelVal(int accelerometerValue);
 // helper function to convert from uT to a 16-bit unsigned val
 uint16_t convertMagVal(int magValue);
 
-// Flash the message 
-void flashMessage(MicroBitEvent)
+void BBMicroBitInit()
 {
-    uint8_t i = 0;
-    uint8_t state = 0;
-    flashOn = true;
-    // Checks if a different message or symbol has come by to override the current message
-    // Checks every 200 ms - this prints the symbol for 400 ms and clears the screen for 200 ms
-    while(flashOn && (i < messageLength))
-    {
-        if(newFlash)
-        {
-            i = 0;
-            state = 0;
-            newFlash = false;
-        }
-        if(state == 0)
-        {
-            uBit.display.printAsync(messageFlash[i]);
-        }
-        if(state == 2)
-        {
-            uBit.display.clear(); // clear the display to provide a "flash"
-            i++;
-            state = -1; // reset our state counter (effectively to 0 since we increment it next)
-        }
-        state++;
-        fiber_sleep(200);
-    }
-    // No longer flashing the message
+    // Set up the buzzer's note timing
+    toneSequencerInit();
+
     flashOn = false;
-}
+    memset(pinsInputs, false, 3);
+    // Set the speaker low. Not as a PWM output, the audio pipeline drives it with its own PWM once a note plays
+    uBit.io.speaker.setDigitalValue(0);
 
-// Run the buzzer
-void mbBuzz(MicroBitEvent)
-{
-    uint16_t elapsed = 0;
-    uint16_t localDuration = 0;
-    localDuration = buzzDuration;
-    buzzerRunning = true;
-    // Make a sound if the tone is below 20 KHz and longer than 10 ms
-    if(buzzPeriod > 50 && localDuration > 10) {
-        while(elapsed < (localDuration/4) && buzzerRunning)
-        {
-            // If we've updated the buzzer while it's playing, update to the new values
-            if(newBuzz && buzzDuration > 0) {
-                // easy to convert this into playing from both buzzers if that is desirable on Finch and HB
-                if(whatAmI == A_MB)
-                {
-                    uBit.io.speaker.setAnalogValue(512);
-                    uBit.io.speaker.setAnalogPeriodUs(buzzPeriod);
-                }
-                else
-                {
-                    uBit.io.P0.setAnalogValue(512);
-                    uBit.io.P0.setAnalogPeriodUs(buzzPeriod);    
-                    uBit.io.speaker.setAnalogValue(0);                
-                }
-                elapsed = 0; //resetting elapsed time
-                localDuration = buzzDuration; //resetting the buzz duration
-                newBuzz = false; //making sure we don't update again until a real new value comes in over BLE
-            }
-            // Check every 4 milliseconds
-            fiber_sleep(4); 
-            elapsed++;
-        }
-        if(whatAmI == A_MB)
-        {
-            uBit.io.speaker.setAnalogValue(0);
-        }
-        else
-        {
-            uBit.io.P0.setAnalogValue(0);
-        }        
-    }
-    // Reset the flags
-    newBuzz = false;     
-    buzzerRunning = false;
 }
 
-
-void BBMicroBitInit()
+// Shows a symbol by writing straight into the display's back buffer, no image to allocate and no per pixel checks
+// The 25 pixels are bits 24 to 0 of the four bytes, MSB first. Bit n is pixel (n % 5, n / 5), the same order as the buffer
+void setDisplaySymbol(const uint8_t symbol[4])
 {
-    // Set up a listener for flashing messages    
-    uBit.messageBus.listen(BB_ID, FLASH_MSG_EVT, flashMessage);
-    // Set one up for the buzzer
-    uBit.messageBus.listen(BB_ID, MB_BUZZ_EVT, mbBuzz);
-
-    flashOn = false;
-    newFlash = false;
-    buzzerRunning = false;
-    memset(pinsInputs, false, 3);
-    messageLength = 0; 
-    buzzPeriod = 0;
-    buzzDuration = 0;
-        // Set the speaker low
-    uBit.io.speaker.setAnalogValue(0);
+    animationStop(); // the app is drawing for itself now
+    flashOn = false; // Turn of flashing the message if printing a symbol now
 
+    uint32_t imageVals = ((uint32_t)symbol[0]<<24) | ((uint32_t)symbol[1]<<16) | ((uint32_t)symbol[2]<<8) | symbol[3];
+    uint8_t *pixels = uBit.display.beginFrame();
+    for(int i = 0; i < SYMBOL_PIXELS; i++)
+    {
+        pixels[i] = (imageVals & 0x01) ? 255 : 0;
+        imageVals >>= 1;
+    }
+    uBit.display.endFrame(); // shown whole from the next display frame
 }
 
 // Set the display based on the bluetooth command
 void decodeAndSetDisplay(uint8_t displayCommands[], uint8_t commandLength)
 {
+    animationStop(); // the app is drawing for itself now
     if ((displayCommands[1] & SYMBOL) && commandLength >= 6) //In this case we are going to display a symbol 
     {
-        flashOn = false; // Turn of flashing the message if printing a symbol now
-        MicroBitImage bleImage(5,5);
-        
-        uint32_t imageVals = 0; // puts all 25 bits into a single value
-        uint8_t currentByte = 0;
-        for(int i = 2; i<6;i++)
-        {
-            currentByte = displayCommands[i];
-            imageVals   = imageVals | currentByte<<(24-8*(i-2));
-        }
-        for(int row = 0; row < 5; row++)
-        {
-            for(int col = 0; col < 5; col++)
-            {
-                if(imageVals & 0x01<<(col*5+row)) 
-                {
-                    bleImage.setPixelValue(row, col, 255);
-                }
-                else
-                {
-                    bleImage.setPixelValue(row, col, 0);
-                }
-            }
-        }
-        uBit.display.clear();
-        uBit.display.printAsync(bleImage);
+        setDisplaySymbol(&displayCommands[2]);
     }
     else if(displayCommands[1] & SCROLL) // In this state we print a message
     {
         uBit.display.clear(); // in case someone sent an empty message
-        messageLength= (displayCommands[1] & 0x1F);// This gets us the length of the message to print
+        uint8_t messageLength = (displayCommands[1] & 0x1F);// This gets us the length of the message to print
         if(commandLength >= (messageLength+2))
         {
-            // flash the characters - necessary for now since scrolling is slower and messes with
-            // printing multiple messages. Could fix the timing in the apps later for V2
-            for(int i = 0; i < messageLength; i++)
-            {
-                messageFlash[i] = displayCommands[i+2];
-            }
-            // Launch an event only if we're not currently flashing a message
-            if(!flashOn && messageLength > 0) {
-                MicroBitEvent evt(BB_ID, FLASH_MSG_EVT); 
-            }
-            else {
-                newFlash = true; // Set this true if we're overwriting a currently flashing message
-            }
+            // Shows straight away, replacing any message that is already showing
+            textDisplayShow(&displayCommands[2], messageLength);
         }
     }
     else // if neither of these, clear the display
@@ -193,28 +79,32 @@ void decodeAndSetPins(uint8_t displayCommands[])
         // only activate the buzzer if the command is valid
         if(period > 0 && duration > 10)
         {
-            // updating the global variables
-            buzzPeriod = period;
-            buzzDuration = duration;
-            newBuzz = true; //Turning this on to update the loop in case the event is already active
-            
-            if(!buzzerRunning) {
-                // Launching the event if it's not already running
-                MicroBitEvent evt(BB_ID, MB_BUZZ_EVT);
-            } 
+            // Replaces any note that is already playing
+            toneSequencerPlay(period, duration);
         }
     }
     // input mode
     else if((displayCommands[4] & 0x30) == 0x10)
     {
         // Tells the sensor data function to treat this pin as an analog input and configures it as an analog input
+        pinEventsDisable(0);
         pinsInputs[0] = true;
         uBit.io.P0.getAnalogValue();
+        edgeInputEnable(0);
+    }
+    // edge event mode, counts and times the edges
+    else if((displayCommands[4] & 0x30) == 0x30)
+    {
+        pinsInputs[0] = false;
+        edgeInputDisable(0);
+        pinEventsEnable(0);
     }
     // set PWM mode
     else
     {
         pinsInputs[0] = false;
+        edgeInputDisable(0);
+        pinEventsDisable(0);
         pwmVal = 4*displayCommands[5]; 
         uBit.io.P0.setAnalogValue(pwmVal);        
     }
@@ -223,13 +113,24 @@ void decodeAndSetPins(uint8_t displayCommands[])
     if((displayCommands[4] & 0x0C) == 0x04)
     {
         // Tells the sensor data function to treat this pin as an analog input and configures it as an analog input
+        pinEventsDisable(1);
         pinsInputs[1] = true;
         uBit.io.P1.getAnalogValue();
+        edgeInputEnable(1);
+    }
+    // edge event mode, counts and times the edges
+    else if((displayCommands[4] & 0x0C) == 0x0C)
+    {
+        pinsInputs[1] = false;
+        edgeInputDisable(1);
+        pinEventsEnable(1);
     }
     // set PWM mode
     else
     {
         pinsInputs[1] = false;
+        edgeInputDisable(1);
+        pinEventsDisable(1);
         pwmVal = 4*displayCommands[6]; 
         uBit.io.P1.setAnalogValue(pwmVal);
     }
@@ -238,13 +139,24 @@ void decodeAndSetPins(uint8_t displayCommands[])
     if((displayCommands[4] & 0x03) == 0x01)
     {
         // Tells the sensor data function to treat this pin as an analog input and configures it as an analog input
+        pinEventsDisable(2);
         pinsInputs[2] = true;
         uBit.io.P2.getAnalogValue();
+        edgeInputEnable(2);
+    }
+    // edge event mode, counts and times the edges
+    else if((displayCommands[4] & 0x03) == 0x03)
+    {
+        pinsInputs[2] = false;
+        edgeInputDisable(2);
+        pinEventsEnable(2);
     }
     // set PWM mode
     else
     {
         pinsInputs[2] = false;
+        edgeInputDisable(2);
+        pinEventsDisable(2);
         pwmVal = 4*displayCommands[7]; 
         uBit.io.P2.setAnalogValue(pwmVal);
     }
@@ -257,22 +169,18 @@ void setBuzzer(uint16_t period, uint16_t duration)
     // only activate the buzzer if the command is valid
     if(period > 0 && duration > 10)
     {
-        buzzPeriod = period;
-        buzzDuration = duration;
-        if(buzzDuration > 0) {
-            newBuzz = true; //Turning this on to update the loop in case the event is already active
-        }
-        if(!buzzerRunning) {
-            // Launching the event if it's not already running
-            MicroBitEvent evt(BB_ID, MB_BUZZ_EVT);
-        } 
+        // Replaces any note that is already playing
+        toneSequencerPlay(period, duration);
     }
 }
 
 void getEdgeConnectorVals(uint8_t (&sensor_vals)[V2_SENSOR_SEND_LENGTH])
 {
     for(int i = 0; i < 3; i++) {
-        if(pinsInputs[i])
+        uint16_t value;
+        if(pinsInputs[i] && edgeInputRead(i, value))
+            sensor_vals[i] = value/4; // Averaged by the ADC sampler, convert to 0 to 255
+        else if(pinsInputs[i])
             sensor_vals[i] = uBit.io.pin[i].getAnalogValue()/4; // Convert value to 0 to 255
         else
             sensor_vals[i] = 0xFF; // Matching V1 behavior, could be 0x00 as easily
@@ -462,19 +370,13 @@ uint16_t convertMagVal(int magValue)
 
 void stopMB()
 {
-    buzzerRunning = false; // Stop the buzzer
-    buzzPeriod = 0;
-    buzzDuration = 0;
-    if(whatAmI == A_MB)
-    {
-        uBit.io.speaker.setAnalogValue(0); 
-    }
-    else {
-        uBit.io.P0.setAnalogValue(0);
-    }
+    toneSequencerStop(); // Stop the buzzer
     flashOn = false; // Turn off any messages that are flashing
+    animationStop();
     uBit.display.clear(); // Clear the display
     if(whatAmI == A_MB) {
+        for(int i = 0; i < PIN_EVENT_PINS; i++)
+            pinEventsDisable(i);
     // Set the edge connector inputs to analog inputs
         uBit.io.P0.getAnalogValue();
         uBit.io.P1.getAnalogValue();
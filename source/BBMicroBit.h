@@ -3,9 +3,13 @@
 
 #include "BLESerial.h"
 
+#define SYMBOL_PIXELS 25
+
 // Function that decodes the display command
 void BBMicroBitInit();
 void decodeAndSetDisplay(uint8_t displayCommands[], uint8_t commandLength);
+// Shows a 25 bit symbol, packed in four bytes as in the SYMBOL command
+void setDisplaySymbol(const uint8_t symbol[4]);
 // This function sets the edge connector pins or internal buzzer
 void decodeAndSetPins(uint8_t displayCommands[]);
 
@@ -0,0 +1,132 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "BLELinks.h"
+
+static BleLink links[MAX_BLE_LINKS];
+
+// Finds the slot for a connection, or a free slot if create is true and we haven't seen it before
+static BleLink* findLink(uint16_t handle, bool create)
+{
+    BleLink *freeSlot = NULL;
+    for(int i = 0; i < MAX_BLE_LINKS; i++)
+    {
+        if(links[i].handle == handle)
+            return &links[i];
+        if(freeSlot == NULL && links[i].handle == BLE_CONN_HANDLE_INVALID)
+            freeSlot = &links[i];
+    }
+    if(create && freeSlot != NULL)
+    {
+        freeSlot->handle = handle;
+        freeSlot->report = LINK_REPORT_NONE;
+        freeSlot->pendingLength = 0;
+        return freeSlot;
+    }
+    return NULL;
+}
+
+// Tries to send a packet to one link. If the queue is full we keep only the newest packet, older sensor data is stale anyway
+static void sendToLink(BleLink *link, const uint8_t *buf, uint8_t length)
+{
+    int result = bleuart->sendTo(link->handle, buf, length);
+    if(result == MICROBIT_BUSY)
+    {
+        if(buf != link->pending)
+            memcpy(link->pending, buf, length);
+        link->pendingLength = length;
+    }
+    else
+    {
+        link->pendingLength = 0;
+    }
+}
+
+void bleLinksInit()
+{
+    for(int i = 0; i < MAX_BLE_LINKS; i++)
+    {
+        links[i].handle = BLE_CONN_HANDLE_INVALID;
+        links[i].report = LINK_REPORT_NONE;
+        links[i].pendingLength = 0;
+    }
+}
+
+void bleLinksPrune()
+{
+    for(int i = 0; i < MAX_BLE_LINKS; i++)
+    {
+        if(links[i].handle != BLE_CONN_HANDLE_INVALID && !bleuart->getConnected(links[i].handle))
+        {
+            links[i].handle = BLE_CONN_HANDLE_INVALID;
+            links[i].report = LINK_REPORT_NONE;
+            links[i].pendingLength = 0;
+        }
+    }
+}
+
+void bleLinkSetReport(uint16_t handle, uint8_t report)
+{
+    if(handle == BLE_CONN_HANDLE_INVALID)
+        return;
+    BleLink *link = findLink(handle, true);
+    if(link != NULL)
+    {
+        link->report = report;
+    }
+}
+
+bool bleLinksReporting(uint8_t report)
+{
+    for(int i = 0; i < MAX_BLE_LINKS; i++)
+    {
+        if(links[i].handle != BLE_CONN_HANDLE_INVALID && links[i].report == report)
+            return true;
+    }
+    return false;
+}
+
+uint8_t bleLinksCount()
+{
+    uint8_t count = 0;
+    for(int i = 0; i < MAX_BLE_LINKS; i++)
+    {
+        if(links[i].handle != BLE_CONN_HANDLE_INVALID)
+            count++;
+    }
+    return count;
+}
+
+void bleLinkSend(uint16_t handle, const uint8_t *buf, uint8_t length)
+{
+    if(handle == BLE_CONN_HANDLE_INVALID || length > BLE__MAX_PACKET_LENGTH)
+        return;
+    BleLink *link = findLink(handle, true);
+    if(link != NULL)
+    {
+        sendToLink(link, buf, length);
+    }
+}
+
+void bleLinksSendReport(uint8_t report, const uint8_t *buf, uint8_t length)
+{
+    if(length > BLE__MAX_PACKET_LENGTH)
+        return;
+    for(int i = 0; i < MAX_BLE_LINKS; i++)
+    {
+        if(links[i].handle != BLE_CONN_HANDLE_INVALID && links[i].report == report)
+        {
+            sendToLink(&links[i], buf, length);
+        }
+    }
+}
+
+void bleLinksFlush()
+{
+    for(int i = 0; i < MAX_BLE_LINKS; i++)
+    {
+        if(links[i].handle != BLE_CONN_HANDLE_INVALID && links[i].pendingLength > 0)
+        {
+            sendToLink(&links[i], links[i].pending, links[i].pendingLength);
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef BLELINKS_H
+#define BLELINKS_H
+
+#include "BirdBrain.h"
+
+// Up to two apps can be connected at once, e.g. a student's app driving the robot and a teacher dashboard watching it
+// Must match NRF_SDH_BLE_PERIPHERAL_LINK_COUNT in codal.json
+#define MAX_BLE_LINKS                             2
+
+// Which sensor report a link has asked for
+#define LINK_REPORT_NONE                          0
+#define LINK_REPORT_V1                            1
+#define LINK_REPORT_V2                            2
+#define LINK_REPORT_V3                            3 // V2 reports followed by the extended Finch reports
+
+// State we keep for each connected app
+typedef struct {
+    uint16_t handle;                              // connection handle, BLE_CONN_HANDLE_INVALID if the slot is free
+    uint8_t report;                               // LINK_REPORT_NONE if this app hasn't turned notifications on
+    uint8_t pending[BLE__MAX_PACKET_LENGTH];      // latest packet that didn't fit in the SoftDevice queue, retried next tick
+    uint8_t pendingLength;                        // 0 if nothing is waiting
+} BleLink;
+
+void bleLinksInit();
+void bleLinksPrune(); // Frees the slots of apps that have disconnected
+void bleLinkSetReport(uint16_t handle, uint8_t report); // Turns notifications on or off for one app
+bool bleLinksReporting(uint8_t report); // True if any app wants this report
+uint8_t bleLinksCount(); // Number of apps we're holding state for
+void bleLinkSend(uint16_t handle, const uint8_t *buf, uint8_t length); // Sends to one app, keeping the packet if its queue is full
+void bleLinksSendReport(uint8_t report, const uint8_t *buf, uint8_t length); // Sends one encoded report to every app that wants it
+void bleLinksFlush(); // Retries any packets that didn't fit in the queue last time
+
+#endif
@@ -13,7 +13,8 @@ bool calibrationSuccess = false; // Holds if calibration succeeded
 bool calibrationAttempt = false; // Holds if we've made a calibration attempt yet
 MicroBitUARTService *bleuart;
 bool processCommand = false; // Flag to hold off sending sensor data until we have first processed an inbound command
-bool v2report = false; // Flag to hold if we are reporting V2 data
+bool v2report = false; // Flag to hold if we are reporting V2 data - true if any connected app wants V2 reports
+bool sensorFiberRunning = false; // Makes sure we only ever have one send_ble_data fiber
 
 
 // Checks if the Finch has received any BLE messages recently - if not, Finch will go to sleep
@@ -25,6 +26,12 @@ uint8_t bufferLength = 0;
 int16_t micSamples[MIC_SAMPLES]; // Holds 8 samples of microphone data to determine loudness
 uint8_t loudness; // Holds the loudness of microphone - the difference between the min and max of the 8 samples
 
+static uint8_t batteryLevel = 0xFF; // Raw battery level from the last good SPI read
+static uint32_t batteryTime = 0; // System time of that read
+
+static const ToneNote connectSound[CHIME_NOTES] = {{3039, CHIME_NOTE_LENGTH}, {1912, CHIME_NOTE_LENGTH}, {1703, CHIME_NOTE_LENGTH}, {1351, CHIME_NOTE_LENGTH}};
+static const ToneNote disconnectSound[CHIME_NOTES] = {{1702, CHIME_NOTE_LENGTH}, {2024, CHIME_NOTE_LENGTH}, {2551, CHIME_NOTE_LENGTH}, {3816, CHIME_NOTE_LENGTH}};
+
 // Convenience function to read the command packet, returns false if it timed out
 bool getCommands(uint8_t commands[], uint8_t startIndex, uint8_t length);
 
@@ -34,6 +41,12 @@ bool readOneByte(uint8_t commands[], int index);
 // Function to get the loudness of the set of microphone samples
 void getLoudnessVal();
 
+// Works out which reports we need to send from what each connected app has asked for
+void updateNotifyState();
+
+// Fiber that keeps the device state in the scan response up to date
+void advertisingStateLoop();
+
 // Sends BLE sensor data approx every 30-40 ms (varies a bit on what else is going on)
 // Also reads the microphone once per 4 millisecond
 void send_ble_data()
@@ -49,6 +62,7 @@ void send_ble_data()
             micSamples[loopCount] = uBit.io.microphone.getAnalogValue();
         }
         fiber_sleep(1); // this appears to actually take 4 ms in our testing
+        bleLinksFlush(); // retry anything that didn't fit in an app's queue last time
         loopCount++;
         if(loopCount >= MIC_SAMPLES)
         {
@@ -56,7 +70,7 @@ void send_ble_data()
             if(v2report) {
                 getLoudnessVal();
             }
-            assembleSensorData(); // assembles and sends a sensor packet
+            sendSensorReports(); // assembles and sends a sensor packet to each app that wants one
             // Used for testing the actual time between sensor packets
            /* elapsedTime = uint16_t(uBit.systemTime()-previousTime);
             previousTime = uBit.systemTime();
@@ -65,6 +79,7 @@ void send_ble_data()
             uBit.serial.send("\r\n");*/
         }
     }
+    sensorFiberRunning = false;
     release_fiber();
 }
 
@@ -90,19 +105,53 @@ void getLoudnessVal()
 }
 
 
+// Turns the sensor fiber and microphone on or off to match what the connected apps have asked for
+void updateNotifyState()
+{
+    bool needV2 = bleLinksReporting(LINK_REPORT_V2) || bleLinksReporting(LINK_REPORT_V3);
+
+    if(needV2 && !v2report)
+    {
+        // Increase the gain of the microphone ADC
+        if(mic == NULL) {
+            mic = uBit.adc.getChannel(uBit.io.microphone);
+            mic->setGain(7,0);   
+        } 
+        // Power up the microphone
+        uBit.io.runmic.setDigitalValue(1);
+        uBit.io.runmic.setHighDrive(true);
+    }
+    else if(!needV2 && v2report)
+    {
+        // Turn off the microphone
+        uBit.io.runmic.setDigitalValue(0);
+    }
+    v2report = needV2;
+
+    notifyOn = needV2 || bleLinksReporting(LINK_REPORT_V1);
+    // Only pay for light sensing while someone is reading it. Each sample darkens the display for one extra row period, about 3 ms, every LIGHT_SENSE_FRAMES frames
+    uBit.display.setLightSenseInterval(bleLinksReporting(LINK_REPORT_V3) ? LIGHT_SENSE_FRAMES : 0);
+    if(notifyOn && !sensorFiberRunning)
+    {
+        sensorFiberRunning = true;
+        create_fiber(send_ble_data); // Sends sensor data every 30 ms
+    }
+}
+
 void onConnected(MicroBitEvent)
 {
     bleConnected = true;
     playConnectSound();
 }
 
+// Called once for each app that disconnects - another app may still be connected
 void onDisconnected(MicroBitEvent)
 {
-    bleConnected = false;
-    notifyOn = false; // in case this was not reset by the computer/tablet
+    bleLinksPrune(); // forget the app that left, in case this was not reset by the computer/tablet
+    bleConnected = bleuart->getConnected();
     flashOn = false; // Turning off any current message being printed to the screen
+    // The app that left may have been driving, so always stop the outputs
     stopMB(); // Stops the LED screen and buzzer, and if a MB sets edge connector pins to inputs
-    playDisconnectSound();
     if(whatAmI == A_FINCH)
     {
         stopFinch();
@@ -111,11 +160,9 @@ void onDisconnected(MicroBitEvent)
     {
         stopHB();
     }
-    // Turn off the microphone
-    if(v2report)
-    {
-        uBit.io.runmic.setDigitalValue(0);
-    }
+    playDisconnectSound(); // after stopHB, which turns the buzzer pin off
+    updateNotifyState(); // stops notifications and the microphone if no one is left to send them to
+    deviceDetectKick(); // someone may be about to move the micro:bit to another robot, so watch closely for a while
 }
 
 void sleepTimer()
@@ -135,6 +182,7 @@ void sleepTimer()
                 if(playDisconnectWhenTimedOut) {
                     playDisconnectSound(); // play a sound to tell people we're turning off
                     playDisconnectWhenTimedOut = false;
+                    fiber_sleep(CHIME_NOTES * CHIME_NOTE_LENGTH); // let it finish before the Finch turns off
                 }
                 turnOffFinch();
             }
@@ -149,7 +197,7 @@ void flashInitials()
     {
         if(!bleConnected) {
             // Print one of three initials
-            uBit.display.printAsync(initials_name[count]);
+            textDisplayChar(initials_name[count]);
             fiber_sleep(400);
             uBit.display.clear();
             fiber_sleep(200);
@@ -172,17 +220,15 @@ void flashInitials()
 void bleSerialInit(ManagedString devName) 
 {
     bleuart = new MicroBitUARTService(*uBit.ble, 240, 32);  // increasing the buffer size to catch more near simultaneous commands
+    bleLinksInit();
 
     //uBit.ble->stopAdvertising();
 
-    fiber_sleep(10); //Give the UART service a moment to register
-
     // Configure advertising with the UART service added, and with our prefix added
+    // Registering the service and configuring advertising are synchronous SoftDevice calls, so there is no need to wait between them
+    updateAdvertisingState();
     uBit.ble->configAdvertising(devName);
     
-    // Waiting for the BLE stack to stabilize
-    fiber_sleep(100);
-    
     uBit.ble->setTransmitPower(7); 
     uBit.ble->advertise();
     
@@ -190,6 +236,7 @@ void bleSerialInit(ManagedString devName)
     uBit.messageBus.listen(MICROBIT_ID_BLE, MICROBIT_BLE_EVT_DISCONNECTED, onDisconnected, MESSAGE_BUS_LISTENER_REENTRANT);
     create_fiber(flashInitials); // Start flashing since we're disconnected
     create_fiber(sleepTimer);  // Start a fiber to check if we need to switch off the Finch due to inactivity
+    create_fiber(advertisingStateLoop); // Keep the battery level in the scan response up to date
     v2report = false; // making sure we start in this state
 }
 
@@ -205,7 +252,8 @@ void bleSerialCommand()
     if(bleConnected && bleuart->isReadable() && (processCommand == false))
     {
         processCommand = true; // set a flag that tells the sensor packet function not to interrupt this
-        bufferLength = bleuart->rxBufferedSize(); // Get the length of the buffer, can contain multiple packets
+        uint16_t commandLink = bleuart->rxNextHandle(); // the app these commands came from
+        bufferLength = bleuart->rxBufferedSize(commandLink); // Get the length of that app's bytes, can contain multiple packets. Another app's bytes wait for the next pass
 
         uint8_t ble_read_buff[bufferLength]; // local buffer to hold our command packet
         memset(ble_read_buff, 0, bufferLength); // resetting the buffer
@@ -264,47 +312,46 @@ void bleSerialCommand()
                 // Returns the firmware and hardware versions
                 case SET_FIRMWARE: 
                 case FINCH_SET_FIRMWARE:      
-                    returnFirmwareData();
+                    returnFirmwareData(commandLink);
                     commandCount++;
                     break;        
+                // Returns connection interval, RSSI, PHY and notification counts for this app's link
+                case LINK_DIAGNOSTICS:
+                    returnLinkDiagnostics(commandLink);
+                    commandCount++;
+                    break;
+                // Returns how long each phase of boot took
+                case BOOT_DIAGNOSTICS:
+                    returnBootTrace(commandLink);
+                    commandCount++;
+                    break;
                 // Command to start or stop sensor notifications        
                 case NOTIFICATIONS:
                     commandCount++;
                     if(bufferLength > commandCount)
                     {
+                        // Notifications are per app, updateNotifyState starts the sensor fiber and microphone as needed
                         if(ble_read_buff[commandCount] == START_NOTIFY) {
-                            v2report = false;
-                            notifyOn = true;
-                            create_fiber(send_ble_data); // Sends sensor data every 30 ms
+                            bleLinkSetReport(commandLink, LINK_REPORT_V1);
+                            updateNotifyState();
                             commandCount++;
-                            // In the unlikely event that we go from reporting V2 style reports to V1 without stopping notifications
-                            if(v2report)
-                            {
-                                uBit.io.runmic.setDigitalValue(0);
-                            }
                         }
                         // Send V2 compatible reports
                         else if(ble_read_buff[commandCount] == START_NOTIFYV2) {
-                            v2report = true;
-                            notifyOn = true;
-                            create_fiber(send_ble_data); // Sends sensor data every 30 ms
-                            // Increase the gain of the microphone ADC
-                            if(mic == NULL) {
-                                mic = uBit.adc.getChannel(uBit.io.microphone);
-                                mic->setGain(7,0);   
-                            } 
-                            // Power up the microphone
-                            uBit.io.runmic.setDigitalValue(1);
-                            uBit.io.runmic.setHighDrive(true);
+                            bleLinkSetReport(commandLink, LINK_REPORT_V2);
+                            updateNotifyState();
+                            commandCount++;
+                        }
+                        // Send V2 reports plus the extended Finch reports
+                        else if(ble_read_buff[commandCount] == START_NOTIFYV3) {
+                            bleLinkSetReport(commandLink, LINK_REPORT_V3);
+                            updateNotifyState();
                             commandCount++;
                         }
                         else if(ble_read_buff[commandCount] == STOP_NOTIFY) {
-                            notifyOn = false;                            
+                            bleLinkSetReport(commandLink, LINK_REPORT_NONE);
+                            updateNotifyState();
                             commandCount++;
-                            if(v2report)
-                            {
-                                uBit.io.runmic.setDigitalValue(0);
-                            }
                         }
                         bytesUsed = 2; // Uses two bytes
                     }
@@ -345,8 +392,7 @@ void bleSerialCommand()
                     uBit.compass.calibrate();
                     calibrationAttempt = true;
                     calibrationSuccess = uBit.compass.isCalibrated();
-                    notifyOn = true; // restart notifications
-                    create_fiber(send_ble_data); // Restart the notification fiber
+                    updateNotifyState(); // restart notifications for the apps that had them on
                     commandCount++;
                     bytesUsed = 4; // This command sends 0xCE followed by 0xFF three times (or sometimes just 0xCE)
                     break;
@@ -383,6 +429,113 @@ void bleSerialCommand()
                         commandCount++;
                     }
                     break;
+                // Picks how messages are shown on the LED array
+                case MB_TEXT_MODE:
+                    if(bufferLength >= commandCount + TEXT_MODE_LENGTH)
+                    {
+                        bytesUsed = TEXT_MODE_LENGTH;
+                        uint8_t packetCommands[TEXT_MODE_LENGTH];
+                        for(int i = 0; i < bytesUsed; i++)
+                        {
+                            packetCommands[i] = ble_read_buff[i+commandCount];
+                        }
+                        textDisplaySetMode(packetCommands, bytesUsed);
+                        commandCount += bytesUsed;
+                    }
+                    else {
+                        commandCount++;
+                    }
+                    break;
+                // Queues up to four notes at a time on one of the voices, played on the system timer
+                case MB_MELODY:
+                    bytesUsed = (bufferLength >= commandCount + 2) ? toneSequencerCommandLength(ble_read_buff[commandCount+1]) : MELODY_HEADER_LENGTH;
+                    if(bytesUsed == 0)
+                    {
+                        // Too many notes to be a real command, so the rest of the buffer is notes, not opcodes
+                        commandCount = bufferLength;
+                    }
+                    else if(bufferLength >= commandCount + bytesUsed)
+                    {
+                        uint8_t packetCommands[MELODY_HEADER_LENGTH + MELODY_MAX_NOTES*MELODY_NOTE_BYTES];
+                        for(int i = 0; i < bytesUsed; i++)
+                        {
+                            packetCommands[i] = ble_read_buff[i+commandCount];
+                        }
+                        toneSequencerCommand(packetCommands, bytesUsed, commandLink);
+                        commandCount += bytesUsed;
+                    }
+                    else {
+                        commandCount++;
+                    }
+                    break;
+                // Speaker volume and sound expressions
+                case MB_SOUND:
+                    if(bufferLength >= commandCount + SOUND_LENGTH)
+                    {
+                        bytesUsed = SOUND_LENGTH;
+                        uint8_t packetCommands[SOUND_LENGTH];
+                        for(int i = 0; i < bytesUsed; i++)
+                        {
+                            packetCommands[i] = ble_read_buff[i+commandCount];
+                        }
+                        toneSequencerSoundCommand(packetCommands, bytesUsed);
+                        commandCount += bytesUsed;
+                    }
+                    else {
+                        commandCount++;
+                    }
+                    break;
+                // Uploads and plays animations on the LED array
+                case MB_ANIMATION:
+                    bytesUsed = (bufferLength >= commandCount + 2) ? animationCommandLength(ble_read_buff[commandCount+1]) : 2;
+                    if(bufferLength >= commandCount + bytesUsed)
+                    {
+                        uint8_t packetCommands[ANIM_FRAME_GREY_LENGTH];
+                        for(int i = 0; i < bytesUsed; i++)
+                        {
+                            packetCommands[i] = ble_read_buff[i+commandCount];
+                        }
+                        animationCommand(packetCommands, bytesUsed, commandLink);
+                        commandCount += bytesUsed;
+                    }
+                    else {
+                        commandCount++;
+                    }
+                    break;
+                // Picks how a Hummingbird sensor port is filtered
+                case HB_SENSOR_FILTER:
+                    if(whatAmI == A_HB && (bufferLength >= commandCount + HB_FILTER_LENGTH))
+                    {
+                        bytesUsed = HB_FILTER_LENGTH;
+                        uint8_t packetCommands[HB_FILTER_LENGTH];
+                        for(int i = 0; i < bytesUsed; i++)
+                        {
+                            packetCommands[i] = ble_read_buff[i+commandCount];
+                        }
+                        hbSensorFilterCommand(packetCommands, bytesUsed);
+                        commandCount += bytesUsed;
+                    }
+                    else {
+                        commandCount++;
+                    }
+                    break;
+                // Moves a Hummingbird servo smoothly to a new position
+                case HB_SERVO_MOTION:
+                    if(whatAmI == A_HB && (bufferLength >= commandCount + SERVO_MOTION_LENGTH))
+                    {
+                        bytesUsed = SERVO_MOTION_LENGTH;
+                        uint8_t packetCommands[SERVO_MOTION_LENGTH];
+                        for(int i = 0; i < bytesUsed; i++)
+                        {
+                            packetCommands[i] = ble_read_buff[i+commandCount];
+                        }
+                        servoMotionCommand(packetCommands, bytesUsed);
+                        commandCount += bytesUsed;
+                    }
+                    else {
+                        commandCount++;
+                    }
+                    break;
                 // Sets the Finch LEDs + buzzer
                 case FINCH_SETALL_LED:
                     if(whatAmI == A_FINCH && (bufferLength >= commandCount + FINCH_SETALL_LENGTH))
@@ -441,6 +594,40 @@ void bleSerialCommand()
                         }
                     }
                     break;    
+                // Drive a distance, turn an angle or follow an arc, with the micro:bit closing the loop on the encoders
+                case FINCH_MOTION:
+                    if(whatAmI == A_FINCH && (bufferLength >= commandCount + FINCH_MOTION_LENGTH))
+                    {
+                        bytesUsed = FINCH_MOTION_LENGTH;
+                        uint8_t packetCommands[FINCH_MOTION_LENGTH];
+                        for(int i = 0; i < bytesUsed; i++)
+                        {
+                            packetCommands[i] = ble_read_buff[i+commandCount];
+                        }
+                        finchMotionCommand(packetCommands, bytesUsed, commandLink);
+                        commandCount += bytesUsed;
+                    }
+                    else {
+                        commandCount++;
+                    }
+                    break;
+                // Preload and play back a routine of motion segments
+                case FINCH_SEGMENTS:
+                    if(whatAmI == A_FINCH && (bufferLength >= commandCount + FINCH_SEGMENT_LENGTH))
+                    {
+                        bytesUsed = FINCH_SEGMENT_LENGTH;
+                        uint8_t packetCommands[FINCH_SEGMENT_LENGTH];
+                        for(int i = 0; i < bytesUsed; i++)
+                        {
+                            packetCommands[i] = ble_read_buff[i+commandCount];
+                        }
+                        motionQueueCommand(packetCommands, bytesUsed, commandLink);
+                        commandCount += bytesUsed;
+                    }
+                    else {
+                        commandCount++;
+                    }
+                    break;
                 // Finch Stop command
                 case FINCH_STOPALL:
                     stopMB(); // turn off LED array and buzzer
@@ -467,8 +654,8 @@ void bleSerialCommand()
     }
 }
 
-// Collects the notification data and sends it to the computer/tablet
-void assembleSensorData()
+// Collects the notification data and sends it to every app that has asked for it
+void sendSensorReports()
 {
     if(bleConnected && notifyOn)
     {
@@ -483,107 +670,184 @@ void assembleSensorData()
 
         processCommand = true; // This will keep us from executing a command while we gather and send sensor data
 
-        if(whatAmI == A_FINCH)
+        // Each kind of report is assembled once and then sent to every app that wants it
+        uint8_t report[BLE__MAX_PACKET_LENGTH];
+        uint8_t length;
+        if(bleLinksReporting(LINK_REPORT_V1))
         {
-            uint8_t sensor_vals[FINCH_SENSOR_SEND_LENGTH];
-            uint8_t spi_sensors_only[FINCH_SPI_SENSOR_LENGTH];
-            memset(sensor_vals, 0, FINCH_SENSOR_SEND_LENGTH);    
-            
+            length = assembleSensorData(report, false);
+            bleLinksSendReport(LINK_REPORT_V1, report, length);
+        }
+        if(bleLinksReporting(LINK_REPORT_V2) || bleLinksReporting(LINK_REPORT_V3))
+        {
+            length = assembleSensorData(report, true);
+            bleLinksSendReport(LINK_REPORT_V2, report, length);
+            // The V2 report has no room for the light level, so V3 links get it as an extra byte.
+            // The Finch report is already full, there it goes in the encoder report instead
+            if(whatAmI != A_FINCH)
+            {
+                report[length] = uBit.display.readLightLevel();
+                bleLinksSendReport(LINK_REPORT_V3, report, length + 1);
+            }
+            else
+                bleLinksSendReport(LINK_REPORT_V3, report, length);
+        }
+        // V3 apps get the extended Finch reports as separate notifications, each starting with its report ID
+        if(whatAmI == A_FINCH && bleLinksReporting(LINK_REPORT_V3))
+        {
+            uint8_t extReport[FINCH_EXT_REPORT_LENGTH];
+            assembleOdometryReport(extReport);
+            bleLinksSendReport(LINK_REPORT_V3, extReport, FINCH_EXT_REPORT_LENGTH);
+            assembleEncoderReport(extReport);
+            bleLinksSendReport(LINK_REPORT_V3, extReport, FINCH_EXT_REPORT_LENGTH);
+        }
+        // On a micro:bit they get a report for each edge connector pin that is counting edges
+        if(whatAmI == A_MB && bleLinksReporting(LINK_REPORT_V3))
+        {
+            uint8_t pinReport[PIN_REPORT_LENGTH];
+            for(int pin = 0; pin < PIN_EVENT_PINS; pin++)
+            {
+                if(!pinEventsActive(pin))
+                    continue;
+                assemblePinReport(pin, pinReport);
+                bleLinksSendReport(LINK_REPORT_V3, pinReport, PIN_REPORT_LENGTH);
+            }
+        }
+        processCommand = false; // Allow others to interrupt
+    }
+}
+
+// Reads the sensors and packs them into a V1 or V2 report, returns the number of bytes in the report
+uint8_t assembleSensorData(uint8_t (&report)[BLE__MAX_PACKET_LENGTH], bool v2)
+{
+    uint8_t timeOut = 0;
+    uint8_t length = 0;
+
+    if(whatAmI == A_FINCH)
+    {
+        uint8_t sensor_vals[FINCH_SENSOR_SEND_LENGTH];
+        uint8_t spi_sensors_only[FINCH_SPI_SENSOR_LENGTH];
+        memset(sensor_vals, 0, FINCH_SENSOR_SEND_LENGTH);    
+        
+        spiReadFinch(spi_sensors_only);
+
+        // Catch if our SPI sensor packet got interrupted by inbound BLE messages during read
+        while(spi_sensors_only[2] == 0x2C || spi_sensors_only[2] == 0xFF)
+        {
+            fiber_sleep(1);
             spiReadFinch(spi_sensors_only);
+        }             
 
-            // Catch if our SPI sensor packet got interrupted by inbound BLE messages during read
-            while(spi_sensors_only[2] == 0x2C || spi_sensors_only[2] == 0xFF)
-            {
-                fiber_sleep(1);
-                spiReadFinch(spi_sensors_only);
-            }             
+        arrangeFinchSensors(spi_sensors_only, sensor_vals);
+        batteryLevel = spi_sensors_only[8]; // for the scan response, saves it reading the SPI itself
+        batteryTime = uBit.systemTime();
 
-            arrangeFinchSensors(spi_sensors_only, sensor_vals);
+        getAccelerometerValsFinch(sensor_vals);
+        getMagnetometerValsFinch(sensor_vals);
+        getButtonValsFinch(sensor_vals, v2); // Gets the touch sensor if v2 is true
 
-            getAccelerometerValsFinch(sensor_vals);
-            getMagnetometerValsFinch(sensor_vals);
-            getButtonValsFinch(sensor_vals, v2report); // Gets the touch sensor if v2report is true
+        // Probably not necessary as we get feedback from the LED screen            
+        if(calibrationAttempt)
+        {
+            if(calibrationSuccess)
+            {
+                sensor_vals[16] = sensor_vals[16] | 0x04;
+            }
+            else
+            {
+                sensor_vals[16] = sensor_vals[16] | 0x08;
+            }
+        }
+        // Modify the data if we are providing a V2 report
+        if(v2)
+        {
+            uint32_t distance;
+            // converting to cm
+            distance = ((sensor_vals[0] << 8 | sensor_vals[1]) * 919)/10000;
+            // bounding the reading to 8 bits
+            if(distance > 255)
+                distance = 255;
+            // Cramming it into one byte
+            sensor_vals[1] = (uint8_t)(distance);
+            // Using the other byte for the sound level
+            sensor_vals[0] = loudness; // calculated in getLoudnessVal
 
-            // Probably not necessary as we get feedback from the LED screen            
-            if(calibrationAttempt)
+            if(sensor_vals[6] < BATT_THRESH2)
             {
-                if(calibrationSuccess)
-                {
-                    sensor_vals[16] = sensor_vals[16] | 0x04;
-                }
-                else
-                {
-                    sensor_vals[16] = sensor_vals[16] | 0x08;
-                }
+                sensor_vals[6] = 0; // red LED
             }
-            // Modify the data if we are providing a V2 report
-            if(v2report)
+            else if(sensor_vals[6] < BATT_THRESH1)
             {
-                uint32_t distance;
-                // converting to cm
-                distance = ((sensor_vals[0] << 8 | sensor_vals[1]) * 919)/10000;
-                // bounding the reading to 8 bits
-                if(distance > 255)
-                    distance = 255;
-                // Cramming it into one byte
-                sensor_vals[1] = (uint8_t)(distance);
-                // Using the other byte for the sound level
-                sensor_vals[0] = loudness; // calculated in getLoudnessVal
-
-                if(sensor_vals[6] < BATT_THRESH2)
-                {
-                    sensor_vals[6] = 0; // red LED
-                }
-                else if(sensor_vals[6] < BATT_THRESH1)
-                {
-                    sensor_vals[6] = 1; // yellow LEDs
-                }
-                else if(sensor_vals[6] < FULL_BATT)
-                {
-                    sensor_vals[6] = 2; // 3 green LEDs
-                }
-                else
-                {
-                    sensor_vals[6] = 3; // 4 green LEDs
-                }
+                sensor_vals[6] = 1; // yellow LEDs
+            }
+            else if(sensor_vals[6] < FULL_BATT)
+            {
+                sensor_vals[6] = 2; // 3 green LEDs
+            }
+            else
+            {
+                sensor_vals[6] = 3; // 4 green LEDs
+            }
 
 
-                // Now adding the temperature reading into the battery level byte
-                int16_t temperature = uBit.thermometer.getTemperature();
-                if(temperature < 0)
-                    temperature = 0;
-                else if(temperature > 63)
-                    temperature = 63;
-                // Combining temperature and battery level into 1 byte    
-                sensor_vals[6] = ((uint8_t)(temperature)<<2) | sensor_vals[6];
-            }
+            // Now adding the temperature reading into the battery level byte
+            int16_t temperature = uBit.thermometer.getTemperature();
+            if(temperature < 0)
+                temperature = 0;
+            else if(temperature > 63)
+                temperature = 63;
+            // Combining temperature and battery level into 1 byte    
+            sensor_vals[6] = ((uint8_t)(temperature)<<2) | sensor_vals[6];
+        }
 
-            bleuart->send(sensor_vals, sizeof(sensor_vals), ASYNC);
+        length = FINCH_SENSOR_SEND_LENGTH;
+        memcpy(report, sensor_vals, length);
+    }
+    else
+    {
+        uint8_t sensor_vals[V2_SENSOR_SEND_LENGTH];
+        memset(sensor_vals, 0, V2_SENSOR_SEND_LENGTH);
+       
+        if(whatAmI == A_MB)
+        {
+            getEdgeConnectorVals(sensor_vals);
+            sensor_vals[3] = 0xFF; // no battery level reported
         }
-        else
+        
+        // The sampler fiber keeps filtered values ready, only read the SPI here if it hasn't been running
+        if(whatAmI == A_HB && !hbSensorsFiltered(sensor_vals))
         {
-            uint8_t sensor_vals[V2_SENSOR_SEND_LENGTH];
-            memset(sensor_vals, 0, V2_SENSOR_SEND_LENGTH);
-           
-            if(whatAmI == A_MB)
+            // reading Hummingbird sensors + battery level via SPI
+            uint8_t check_vals[V2_SENSOR_SEND_LENGTH];
+            memset(check_vals, 0xFF, V2_SENSOR_SEND_LENGTH);
+
+            // Read the sensors twice, occasionally one sensor value will get corrupted in an SPI transaction
+            spiReadHB(sensor_vals);
+            fiber_sleep(1); // put a delay between the two reads or weird stuff happens
+            spiReadHB(check_vals);
+
+            bool readAgain = false;
+            // check if values are within a small range of each other, otherwise one or the other sensor reading might be off and we should read again
+            for(int i = 0; i < 4; i++)
             {
-                getEdgeConnectorVals(sensor_vals);
-                sensor_vals[3] = 0xFF; // no battery level reported
+                if((sensor_vals[i] > (check_vals[i] + 5)) || (sensor_vals[i] < (check_vals[i] -5)))
+                {
+                    readAgain = true;
+                }
             }
-            
-            if(whatAmI == A_HB)
-            {
-                // reading Hummingbird sensors + battery level via SPI
-                uint8_t check_vals[V2_SENSOR_SEND_LENGTH];
-                memset(check_vals, 0xFF, V2_SENSOR_SEND_LENGTH);
+            timeOut = 0;
 
-                // Read the sensors twice, occasionally one sensor value will get corrupted in an SPI transaction
+            // Read again until they're within range of each other, try this 5 times before giving up
+            while(readAgain && timeOut < 5)
+            {
+                // Read the SPI values again
+                fiber_sleep(1);
                 spiReadHB(sensor_vals);
-                fiber_sleep(1); // put a delay between the two reads or weird stuff happens
+                fiber_sleep(1);
                 spiReadHB(check_vals);
-
-                bool readAgain = false;
-                // check if values are within a small range of each other, otherwise one or the other sensor reading might be off and we should read again
+                
+                readAgain = false;
+                // check if values are within a small range of each other, otherwise one or the other sensor reading might be off
                 for(int i = 0; i < 4; i++)
                 {
                     if((sensor_vals[i] > (check_vals[i] + 5)) || (sensor_vals[i] < (check_vals[i] -5)))
@@ -591,66 +855,51 @@ void assembleSensorData()
                         readAgain = true;
                     }
                 }
-                timeOut = 0;
-
-                // Read again until they're within range of each other, try this 5 times before giving up
-                while(readAgain && timeOut < 5)
-                {
-                    // Read the SPI values again
-                    fiber_sleep(1);
-                    spiReadHB(sensor_vals);
-                    fiber_sleep(1);
-                    spiReadHB(check_vals);
-                    
-                    readAgain = false;
-                    // check if values are within a small range of each other, otherwise one or the other sensor reading might be off
-                    for(int i = 0; i < 4; i++)
-                    {
-                        if((sensor_vals[i] > (check_vals[i] + 5)) || (sensor_vals[i] < (check_vals[i] -5)))
-                        {
-                            readAgain = true;
-                        }
-                    }
-                    timeOut++;
-                }
+                timeOut++;
             }
-            getAccelerometerVals(sensor_vals);
-            getMagnetometerVals(sensor_vals);
-            getButtonVals(sensor_vals, v2report);
-            
-            if(v2report)
+        }
+        if(whatAmI == A_HB)
+        {
+            batteryLevel = sensor_vals[3]; // for the scan response, saves it reading the SPI itself
+            batteryTime = uBit.systemTime();
+        }
+        getAccelerometerVals(sensor_vals);
+        getMagnetometerVals(sensor_vals);
+        getButtonVals(sensor_vals, v2);
+        
+        if(v2)
+        {
+            sensor_vals[14] = loudness;
+
+            // Clamping the thermometer reading between 0 and 63 celsius
+            int16_t temperature = uBit.thermometer.getTemperature();
+            if(temperature < 0)
+                temperature = 0;
+            else if(temperature > 63)
+                temperature = 63;
+            sensor_vals[15] = (uint8_t)(temperature);
+        }
+        // Probably not necessary as we get feedback from the LED screen            
+        if(calibrationAttempt)
+        {
+            if(calibrationSuccess)
             {
-                sensor_vals[14] = loudness;
-
-                // Clamping the thermometer reading between 0 and 63 celsius
-                int16_t temperature = uBit.thermometer.getTemperature();
-                if(temperature < 0)
-                    temperature = 0;
-                else if(temperature > 63)
-                    temperature = 63;
-                sensor_vals[15] = (uint8_t)(temperature);
+                sensor_vals[7] = sensor_vals[7] | 0x04; // report success
             }
-            // Probably not necessary as we get feedback from the LED screen            
-            if(calibrationAttempt)
+            else
             {
-                if(calibrationSuccess)
-                {
-                    sensor_vals[7] = sensor_vals[7] | 0x04; // report success
-                }
-                else
-                {
-                    sensor_vals[7] = sensor_vals[7] | 0x08; // report failure
-                }
+                sensor_vals[7] = sensor_vals[7] | 0x08; // report failure
             }
-
-            //send the data asynchronously
-            if(v2report)
-                bleuart->send(sensor_vals, sizeof(sensor_vals), ASYNC); // sends 16 bytes
-            else
-                bleuart->send(sensor_vals, SENSOR_SEND_LENGTH, ASYNC); // sends 14 bytes of a 16 byte array
         }
-        processCommand = false; // Allow others to interrupt
+
+        if(v2)
+            length = V2_SENSOR_SEND_LENGTH; // sends 16 bytes
+        else
+            length = SENSOR_SEND_LENGTH; // sends 14 bytes of a 16 byte array
+        memcpy(report, sensor_vals, length);
     }
+
+    return length;
 }
 
 // Get the rest of the command packet
@@ -706,97 +955,117 @@ bool readOneByte(uint8_t commands[], int index)
 }
 
 
-void returnFirmwareData()
+// Fills in the firmware data we report over BLE and in the scan response
+void getFirmwareData(uint8_t (&firmware_data)[FIRMWARE_DATA_LENGTH])
 {
     // hardware version is 1 for NXP, 2 for LS - currently uses LS
     // second byte is micro_firmware_version - 0x02 on V1
     // third byte is SAMD firmware version - 0 for MB, 3 for HB, 7 or 44 for Finch
     // Hard coding this for now
-    uint8_t return_buff[4];
-    return_buff[0] = 2;
-    return_buff[1] = 2;
+    firmware_data[0] = 2;
+    firmware_data[1] = 2;
     if(whatAmI == A_MB)
     {
-        return_buff[2] = 0xFF;
+        firmware_data[2] = 0xFF;
     } 
     else if(whatAmI == A_HB)
     {
-        return_buff[2] = 3;
+        firmware_data[2] = 3;
     } 
     else if(whatAmI == A_FINCH)
     {
-        return_buff[2] = 44;
+        firmware_data[2] = 44;
     } 
     else
     {
-        return_buff[2] = 0;
+        firmware_data[2] = 0;
     }
-    return_buff[3] = 0x22; // Send an extra byte to indicate we are a version 2 micro:bit
-    bleuart->send(return_buff, 4, ASYNC);
+    firmware_data[3] = 0x22; // Send an extra byte to indicate we are a version 2 micro:bit
 }
 
+void returnFirmwareData(uint16_t handle)
+{
+    uint8_t return_buff[FIRMWARE_DATA_LENGTH];
+    getFirmwareData(return_buff);
+    bleLinkSend(handle, return_buff, FIRMWARE_DATA_LENGTH); // reply to the app that asked
+}
 
-// Plays the connect sound
-void playConnectSound()
+// Reads the raw battery level from the SAMD, 0xFF if we're a standalone micro:bit
+// Reports running for an app read the battery anyway, so use their reading rather than competing with them for the SPI.
+// A read that gets interrupted keeps the last good level
+uint8_t readBatteryLevel()
 {
-    // Plays the BirdBrain connect song, over the built-in speaker if a micro:bit, or over Finch/HB buzzer if not 
     if(whatAmI == A_MB)
+        return 0xFF;
+    if(uBit.systemTime() - batteryTime < BATTERY_SAMPLE_FRESH)
+        return batteryLevel;
+
+    if(whatAmI == A_HB)
     {
-        uBit.io.speaker.setAnalogValue(512);
-        uBit.io.speaker.setAnalogPeriodUs(3039);
-        fiber_sleep(100);
-        uBit.io.speaker.setAnalogPeriodUs(1912);
-        fiber_sleep(100);
-        uBit.io.speaker.setAnalogPeriodUs(1703);
-        fiber_sleep(100);
-        uBit.io.speaker.setAnalogPeriodUs(1351);
-        fiber_sleep(100);
-        uBit.io.speaker.setAnalogValue(0);
+        uint8_t hb_vals[V2_SENSOR_SEND_LENGTH];
+        memset(hb_vals, 0xFF, V2_SENSOR_SEND_LENGTH);
+        if(spiReadHB(hb_vals))
+        {
+            batteryLevel = hb_vals[3];
+            batteryTime = uBit.systemTime();
+        }
     }
-    else 
+    else if(whatAmI == A_FINCH)
     {
-        uBit.io.P0.setAnalogValue(512);
-        uBit.io.P0.setAnalogPeriodUs(3039);
-        fiber_sleep(100);
-        uBit.io.P0.setAnalogPeriodUs(1912);
-        fiber_sleep(100);
-        uBit.io.P0.setAnalogPeriodUs(1703);
-        fiber_sleep(100);
-        uBit.io.P0.setAnalogPeriodUs(1351);
-        fiber_sleep(100);
-        uBit.io.P0.setAnalogValue(0);
-    }    
+        uint8_t finch_vals[FINCH_SPI_SENSOR_LENGTH];
+        memset(finch_vals, 0xFF, FINCH_SPI_SENSOR_LENGTH);
+        spiReadFinch(finch_vals);
+        if(finch_vals[2] != 0x2C && finch_vals[2] != 0xFF) // same check as the sensor reports
+        {
+            batteryLevel = finch_vals[8]; // becomes sensor_vals[6] in arrangeFinchSensors
+            batteryTime = uBit.systemTime();
+        }
+    }
+    return batteryLevel;
 }
 
-// Plays the disconnect sound
-void playDisconnectSound()
+// Puts our device type, firmware, battery level and initials in the scan response so apps can choose a robot without connecting
+void updateAdvertisingState()
 {
-    // Plays the BirdBrain disconnect song
-    if(whatAmI == A_MB)
+    uint8_t state[ADV_STATE_LENGTH];
+    uint8_t firmware_data[FIRMWARE_DATA_LENGTH];
+
+    getFirmwareData(firmware_data);
+
+    state[0] = whatAmI;
+    memcpy(&state[1], firmware_data, FIRMWARE_DATA_LENGTH);
+    state[5] = readBatteryLevel();
+    state[6] = initials_name[0];
+    state[7] = initials_name[1];
+    state[8] = initials_name[2];
+
+    uBit.ble->setAdvertisingManufacturerData(state, ADV_STATE_LENGTH);
+}
+
+// Refreshes the scan response state whenever we're advertising, which carries on after the first app connects while
+// there's room for another
+void advertisingStateLoop()
+{
+    while(1)
     {
-        uBit.io.speaker.setAnalogValue(512);
-        uBit.io.speaker.setAnalogPeriodUs(1702);
-        fiber_sleep(100);
-        uBit.io.speaker.setAnalogPeriodUs(2024);
-        fiber_sleep(100);
-        uBit.io.speaker.setAnalogPeriodUs(2551);
-        fiber_sleep(100);
-        uBit.io.speaker.setAnalogPeriodUs(3816);
-        fiber_sleep(100);
-        uBit.io.speaker.setAnalogValue(0);
+        if(uBit.ble->isAdvertising())
+        {
+            updateAdvertisingState();
+        }
+        fiber_sleep(ADV_STATE_PERIOD);
     }
-    else
-    {
-        uBit.io.P0.setAnalogValue(512);
-        uBit.io.P0.setAnalogPeriodUs(1702);
-        fiber_sleep(100);
-        uBit.io.P0.setAnalogPeriodUs(2024);
-        fiber_sleep(100);
-        uBit.io.P0.setAnalogPeriodUs(2551);
-        fiber_sleep(100);
-        uBit.io.P0.setAnalogPeriodUs(3816);
-        fiber_sleep(100);
-        uBit.io.P0.setAnalogValue(0);
-    }    
 }
 
+
+// Plays the BirdBrain connect song, over the built-in speaker if a micro:bit, or over Finch/HB buzzer if not.
+// The notes are timed by the sequencer, so we don't hold up the caller
+void playConnectSound()
+{
+    toneSequencerPlayNotes(connectSound, CHIME_NOTES, false);
+}
+
+// Plays the BirdBrain disconnect song
+void playDisconnectSound()
+{
+    toneSequencerPlayNotes(disconnectSound, CHIME_NOTES, false);
+}
@@ -15,13 +15,22 @@
 #define SET_LEDARRAY                              0xCC
 #define SET_LED_2                                 0xC1
 #define SET_LED_3                                 0xC2
+#define HB_SERVO_MOTION                           0xC4 // eases a servo to a new position on the micro:bit
+#define HB_SENSOR_FILTER                          0xC5 // picks the filter for a sensor port
+#define MB_ANIMATION                              0xC6 // uploads and plays LED array animations
+#define MB_TEXT_MODE                              0xC7 // flash or scroll messages, and how fast
+#define MB_MELODY                                 0xC3 // queues notes on the buzzer
+#define MB_SOUND                                  0xC0 // speaker volume and sound expressions
 #define SET_BUZZER                                0xCD
 #define SET_CALIBRATE                             0xCE
 #define SET_FIRMWARE                              0xCF
 #define STOP_ALL                                  0xCB
+#define LINK_DIAGNOSTICS                          0xC9
+#define BOOT_DIAGNOSTICS                          0xC8
 #define NOTIFICATIONS                             0x62
 #define START_NOTIFY                              0x67
 #define START_NOTIFYV2                            0x70
+#define START_NOTIFYV3                            0x71 // V2 reports, plus extended reports (odometry) on a Finch
 #define STOP_NOTIFY                               0x73
 
 #define FINCH_SETALL_LED			              0xD0
@@ -29,6 +38,8 @@
 #define FINCH_SET_FIRMWARE                        0xD4
 #define FINCH_RESET_ENCODERS                      0xD5
 #define FINCH_POWEROFF_SAMD                       0xD6
+#define FINCH_MOTION                              0xD8 // closed loop drive, turn and arc
+#define FINCH_SEGMENTS                            0xD9 // queue of timed motion segments played back on the micro:bit
 #define FINCH_STOPALL                             0xDF
 
 #define BROADCAST                                 'b'
@@ -44,9 +55,18 @@
 #define V2_SENSOR_SEND_LENGTH             	      16
 #define FINCH_SENSOR_SEND_LENGTH                  20
 #define BLE__MAX_PACKET_LENGTH                    20 
+#define CHIME_NOTES                               4 // connect and disconnect sounds
+#define CHIME_NOTE_LENGTH                         100 // ms
+#define LIGHT_SENSE_FRAMES                        30 // display frames between light readings while V3 reports run, about 2 Hz
 
 #define MIC_SAMPLES                               8
 
+#define FIRMWARE_DATA_LENGTH                      4
+// Device state carried in the scan response: whatAmI, firmware data, battery, initials
+#define ADV_STATE_LENGTH                          9
+#define ADV_STATE_PERIOD                          5000 // ms between scan response refreshes while we're advertising
+#define BATTERY_SAMPLE_FRESH                      1000 // ms a battery level from a sensor report stands in for a fresh SPI read
+
 #define FULL_BATT                                 100                          //All four tail LEDS are green above this
 #define BATT_THRESH1                              55							//Three tail LEDS are green above this
 #define BATT_THRESH2                              40							//Two Tail LEDS are yellow above this
@@ -54,9 +74,12 @@
 
 void bleSerialInit(ManagedString devName);  // Initializes the UART
 void bleSerialCommand(); // Checks what command (setAll, get firmware, etc) is coming over BLE, then acts as necessary
-void assembleSensorData(); // Collects the notification data and sends it to the computer/tablet
+void sendSensorReports(); // Collects the notification data and sends it to every app that has asked for it
+uint8_t assembleSensorData(uint8_t (&report)[BLE__MAX_PACKET_LENGTH], bool v2); // Packs the sensors into a V1 or V2 report
 
-void returnFirmwareData();
+void getFirmwareData(uint8_t (&firmware_data)[FIRMWARE_DATA_LENGTH]);
+void returnFirmwareData(uint16_t handle);
+void updateAdvertisingState();
 void playConnectSound();
 void playDisconnectSound();
 void flashInitials();
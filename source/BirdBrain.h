@@ -8,8 +8,8 @@ extern MicroBit uBit;
 extern MicroBitUARTService *bleuart;
 extern char initials_name[3]; // Holds our fancy name initials
 extern uint8_t whatAmI; // Holds whether the device is currently in standalone micro:bit, Finch, or Hummingbird mode 
-extern bool bleConnected; // Holds if connected over BLE
-extern bool notifyOn; // Holds if notifications are on (we are regularly sending sensor packets back)
+extern bool bleConnected; // Holds if any app is connected over BLE
+extern bool notifyOn; // Holds if notifications are on for any app (we are regularly sending sensor packets back)
 extern bool flashOn;
 extern int32_t leftEncoder; //Holds the running value of the left encoder
 extern int32_t rightEncoder; //Holds the running value of the right encoder
@@ -25,6 +25,21 @@ extern uint16_t sleepCounter; // Used to check if we should turn off the Finch d
 #include "Naming.h"
 #include "BBMicroBit.h"
 #include "BLESerial.h"
+#include "BLELinks.h"
+#include "Diagnostics.h"
+#include "Boot.h"
+#include "DeviceDetect.h"
+#include "Odometry.h"
+#include "FinchMotion.h"
+#include "MotionQueue.h"
+#include "ActuatorCache.h"
+#include "ServoMotion.h"
+#include "HBSensors.h"
+#include "Animation.h"
+#include "TextDisplay.h"
+#include "ToneSequencer.h"
+#include "EdgeInputs.h"
+#include "PinEvents.h"
 
 #define RESET_PIN      2 // Pin to reset/turn off Finch - micro:bit pin 1
 
@@ -35,8 +50,11 @@ extern uint16_t sleepCounter; // Used to check if we should turn off the Finch d
 
 // Setting up BB specific events
 #define BB_ID            MICROBIT_ID_NOTIFY+1 // last defined eventId is MICROBIT_ID_NOTIFY==1023 in MicroBitComponent.h 
-#define FLASH_MSG_EVT  1
-#define MB_BUZZ_EVT    2
+#define FLASH_MSG_EVT  1 // next step of a flashing or scrolling message
+#define MB_BUZZ_EVT    2 // end of a note on voice 0
+#define ANIM_FRAME_EVT 3
+#define MB_BUZZ1_EVT   4 // end of a note on voice 1
+#define MB_BUZZ2_EVT   5 // end of a note on voice 2
 
 // Time out for Finch to disconnect and turn off if it has not received a command. Currently set to 10 minutes
 #define FINCH_INACTIVITY_TIMEOUT                           10
@@ -0,0 +1,89 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "Boot.h"
+
+static uint16_t phaseDuration[BOOT_PHASE_COUNT]; // ms spent in each phase
+static uint32_t lastMark = 0; // system time of the last mark, the system timer starts at 0 in uBit.init
+static uint8_t identifyPolls = 0; // how many times we asked the SAMD before it answered
+static uint8_t identifiedDevice = UNIDENTIFIED_DEV;
+
+void bootTraceMark(uint8_t phase)
+{
+    uint32_t now = uBit.systemTime();
+    if(phase < BOOT_PHASE_COUNT)
+    {
+        uint32_t elapsed = now - lastMark;
+        phaseDuration[phase] = elapsed > 0xFFFF ? 0xFFFF : (uint16_t)elapsed;
+    }
+    lastMark = now;
+}
+
+uint16_t bootPhaseDuration(uint8_t phase)
+{
+    if(phase >= BOOT_PHASE_COUNT)
+        return 0;
+    return phaseDuration[phase];
+}
+
+// Instead of sleeping for the worst case SAMD bootloader time, ask the SAMD what it is on a backoff schedule.
+// A Finch or Hummingbird answers as soon as its application is running. A bare micro:bit never answers, so it waits out the timeout.
+// The reads are voted on the same way as hot-plug detection, since the first reads after reset can be junk
+uint8_t bootIdentifySamd()
+{
+    uint32_t start = uBit.systemTime();
+    uint16_t wait = BOOT_POLL_FIRST;
+
+    identifyPolls = 0;
+    deviceDetectVoteReset();
+    while(true)
+    {
+        fiber_sleep(wait);
+
+        uint8_t device = readFirmwareVersion();
+        if(identifyPolls < 255)
+            identifyPolls++;
+
+        uint8_t winner = deviceDetectVote(device);
+        if(winner == FINCH_SAMD_ID || winner == HUMMINGBIT_SAMD_ID)
+        {
+            identifiedDevice = winner;
+            return winner;
+        }
+
+        uint32_t elapsed = uBit.systemTime() - start;
+        if(elapsed >= BOOT_IDENTIFY_TIMEOUT)
+            break;
+
+        // Confirm a valid read straight away, otherwise back off. Never sleep past the timeout
+        if(device == FINCH_SAMD_ID || device == HUMMINGBIT_SAMD_ID)
+            wait = BOOT_POLL_FIRST;
+        else
+            wait = (wait*2 > BOOT_POLL_MAX) ? BOOT_POLL_MAX : wait*2;
+        if(elapsed + wait > BOOT_IDENTIFY_TIMEOUT)
+            wait = BOOT_IDENTIFY_TIMEOUT - elapsed;
+    }
+
+    identifiedDevice = MICROBIT_SAMD_ID;
+    return MICROBIT_SAMD_ID;
+}
+
+// [BOOT_DIAGNOSTICS, phase count, duration of each phase (2 bytes MSB first), SAMD polls, SAMD ID]
+void assembleBootTrace(uint8_t (&trace)[BOOT_TRACE_LENGTH])
+{
+    trace[0] = BOOT_DIAGNOSTICS;
+    trace[1] = BOOT_PHASE_COUNT;
+    for(int i = 0; i < BOOT_PHASE_COUNT; i++)
+    {
+        trace[2 + 2*i] = phaseDuration[i] >> 8;
+        trace[3 + 2*i] = phaseDuration[i] & 0xFF;
+    }
+    trace[2 + 2*BOOT_PHASE_COUNT] = identifyPolls;
+    trace[3 + 2*BOOT_PHASE_COUNT] = identifiedDevice;
+}
+
+void returnBootTrace(uint16_t handle)
+{
+    uint8_t trace[BOOT_TRACE_LENGTH];
+    assembleBootTrace(trace);
+    bleLinkSend(handle, trace, BOOT_TRACE_LENGTH);
+}
@@ -0,0 +1,28 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include "BirdBrain.h"
+
+// Boot timing
+#define BOOT_RESET_PULSE                          200  // ms the Finch reset line is held high
+#define BOOT_IDENTIFY_TIMEOUT                     1850 // ms after the reset pulse ends before we give up on the SAMD and call ourselves a standalone micro:bit
+#define BOOT_POLL_FIRST                           10   // ms before the first SAMD poll, doubled after each poll up to BOOT_POLL_MAX
+#define BOOT_POLL_MAX                             160
+
+// Boot phases, in the order main() runs them
+#define BOOT_PHASE_INIT                           0 // uBit.init and SPI
+#define BOOT_PHASE_RESET                          1 // Finch reset pulse
+#define BOOT_PHASE_IDENTIFY                       2 // polling the SAMD until it tells us what we are
+#define BOOT_PHASE_NAMING                         3 // working out our initials
+#define BOOT_PHASE_BLE                            4 // UART service and advertising
+#define BOOT_PHASE_COUNT                          5
+
+#define BOOT_TRACE_LENGTH                         (4 + 2*BOOT_PHASE_COUNT)
+
+void bootTraceMark(uint8_t phase); // Records the time since the previous mark as the duration of this phase
+uint16_t bootPhaseDuration(uint8_t phase); // ms spent in a phase, 0 if it hasn't finished
+uint8_t bootIdentifySamd(); // Polls the SAMD until it identifies itself, returns the SAMD ID, MICROBIT_SAMD_ID if nothing answered in time
+void assembleBootTrace(uint8_t (&trace)[BOOT_TRACE_LENGTH]); // Packs the boot trace for the diagnostics opcode
+void returnBootTrace(uint16_t handle); // Sends the boot trace to the app that asked
+
+#endif
@@ -0,0 +1,129 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "DeviceDetect.h"
+
+static uint8_t state = DETECT_STEADY;
+static uint8_t current = MICROBIT_SAMD_ID; // confirmed SAMD ID
+static uint8_t window[DETECT_WINDOW]; // reads taken while confirming
+static uint8_t windowCount = 0;
+static uint8_t fastProbes = 0; // fast probes left before we drop back to the slow interval
+static uint32_t nextProbe = 0; // system time the next probe is due
+
+static bool validDevice(uint8_t device)
+{
+    return device == MICROBIT_SAMD_ID || device == FINCH_SAMD_ID || device == HUMMINGBIT_SAMD_ID;
+}
+
+// Returns the device with at least DETECT_CONFIRM votes in the window, or UNIDENTIFIED_DEV if there isn't one
+static uint8_t windowWinner()
+{
+    for(int i = 0; i < windowCount; i++)
+    {
+        if(!validDevice(window[i]))
+            continue;
+        uint8_t votes = 0;
+        for(int j = 0; j < windowCount; j++)
+        {
+            if(window[j] == window[i])
+                votes++;
+        }
+        if(votes >= DETECT_CONFIRM)
+            return window[i];
+    }
+    return UNIDENTIFIED_DEV;
+}
+
+// Feeds one read into the state machine, returns true if the confirmed device changed
+static bool detectStep(uint8_t device)
+{
+    if(state == DETECT_STEADY)
+    {
+        // Junk reads and reads that agree with us keep us where we are
+        if(!validDevice(device) || device == current)
+            return false;
+
+        state = DETECT_CONFIRMING;
+        windowCount = 0;
+    }
+
+    window[windowCount++] = device;
+
+    uint8_t winner = windowWinner();
+    if(winner != UNIDENTIFIED_DEV)
+    {
+        state = DETECT_STEADY;
+        if(winner != current)
+        {
+            current = winner;
+            fastProbes = DETECT_FAST_PROBES; // keep watching closely in case the robot is still being plugged in
+            return true;
+        }
+        return false;
+    }
+
+    // Not enough agreement in a full window, it was a noisy read. Stay as we are
+    if(windowCount >= DETECT_WINDOW)
+    {
+        state = DETECT_STEADY;
+    }
+    return false;
+}
+
+void deviceDetectInit(uint8_t device)
+{
+    current = validDevice(device) ? device : MICROBIT_SAMD_ID;
+    state = DETECT_STEADY;
+    windowCount = 0;
+    fastProbes = 0;
+    nextProbe = uBit.systemTime() + DETECT_SLOW_INTERVAL;
+}
+
+bool deviceDetectPoll()
+{
+    uint32_t now = uBit.systemTime();
+    if((int32_t)(now - nextProbe) < 0)
+        return false;
+
+    bool changed = detectStep(readFirmwareVersion());
+
+    if(state == DETECT_CONFIRMING || fastProbes > 0)
+    {
+        if(state == DETECT_STEADY)
+            fastProbes--;
+        nextProbe = now + DETECT_FAST_INTERVAL;
+    }
+    else
+    {
+        nextProbe = now + DETECT_SLOW_INTERVAL;
+    }
+    return changed;
+}
+
+void deviceDetectKick()
+{
+    fastProbes = DETECT_FAST_PROBES;
+    nextProbe = uBit.systemTime();
+}
+
+uint8_t deviceDetectCurrent()
+{
+    return current;
+}
+
+uint8_t deviceDetectVote(uint8_t device)
+{
+    // Keep the most recent DETECT_WINDOW reads, dropping the oldest
+    if(windowCount >= DETECT_WINDOW)
+    {
+        memmove(&window[0], &window[1], DETECT_WINDOW - 1);
+        windowCount--;
+    }
+    window[windowCount++] = device;
+    return windowWinner();
+}
+
+void deviceDetectVoteReset()
+{
+    state = DETECT_STEADY;
+    windowCount = 0;
+}
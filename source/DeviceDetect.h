@@ -0,0 +1,27 @@
+#ifndef DEVICEDETECT_H
+#define DEVICEDETECT_H
+
+#include "BirdBrain.h"
+
+// Detection timing
+#define DETECT_TICK                               25   // ms between checks of whether a probe is due
+#define DETECT_FAST_INTERVAL                      50   // ms between probes while a change is being confirmed, or just after one
+#define DETECT_SLOW_INTERVAL                      500  // ms between probes when nothing has changed for a while
+#define DETECT_FAST_PROBES                        20   // fast probes after a change or a kick before dropping back to the slow interval
+
+// N-of-M confirmation, a new device has to win DETECT_CONFIRM of the last DETECT_WINDOW reads
+#define DETECT_WINDOW                             5
+#define DETECT_CONFIRM                            3
+
+// Detection states
+#define DETECT_STEADY                             0 // reads agree with what we think we are
+#define DETECT_CONFIRMING                         1 // a read disagreed, collecting votes before we believe it
+
+void deviceDetectInit(uint8_t device); // Starts the state machine believing we are this SAMD ID
+bool deviceDetectPoll(); // Runs a probe if one is due, returns true if the confirmed device changed
+void deviceDetectKick(); // Probes at the fast interval for a while, e.g. after a disconnect when someone may be swapping robots
+uint8_t deviceDetectCurrent(); // SAMD ID of the confirmed device
+void deviceDetectVoteReset(); // Empties the window before a run of deviceDetectVote() calls
+uint8_t deviceDetectVote(uint8_t device); // Adds one read to the window, returns the device DETECT_CONFIRM of the last DETECT_WINDOW reads agree on, UNIDENTIFIED_DEV if none
+
+#endif
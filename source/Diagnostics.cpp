@@ -0,0 +1,51 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "Diagnostics.h"
+
+// Clamps a counter into one byte
+static uint8_t clampByte(uint32_t value)
+{
+    return value > 255 ? 255 : (uint8_t)value;
+}
+
+static void putUint16(uint8_t *buf, uint16_t value)
+{
+    buf[0] = value >> 8;
+    buf[1] = value & 0xFF;
+}
+
+// Packs the link statistics kept by the BLE manager into one notification sized packet
+void assembleLinkDiagnostics(uint16_t handle, uint8_t (&diag)[DIAGNOSTICS_LENGTH])
+{
+    memset(diag, 0, DIAGNOSTICS_LENGTH);
+    diag[DIAG_OPCODE] = LINK_DIAGNOSTICS;
+
+    uBit.ble->sampleLinkRssi(handle); // the RSSI only updates by itself when the level moves
+    const microbit_ble_link_stats_t *stats = uBit.ble->getLinkStats(handle);
+    if(stats != NULL)
+    {
+        putUint16(&diag[DIAG_CONN_INTERVAL], stats->conn_interval);
+        diag[DIAG_SLAVE_LATENCY] = clampByte(stats->slave_latency);
+        diag[DIAG_RSSI_AVG] = (uint8_t)(int8_t)(stats->rssi_avg_x16 / 16);
+        diag[DIAG_RSSI_MIN] = (uint8_t)stats->rssi_min;
+        diag[DIAG_PHY] = (stats->tx_phy << 4) | (stats->rx_phy & 0x0F);
+        diag[DIAG_MAX_TX_OCTETS] = clampByte(stats->max_tx_octets);
+        diag[DIAG_MAX_RX_OCTETS] = clampByte(stats->max_rx_octets);
+        putUint16(&diag[DIAG_HVN_QUEUE_FULL], stats->hvn_queue_full & 0xFFFF);
+        putUint16(&diag[DIAG_HVN_QUEUED], stats->hvn_queued & 0xFFFF);
+        putUint16(&diag[DIAG_HVN_COMPLETE], stats->hvn_complete & 0xFFFF);
+        diag[DIAG_CONN_PARAM_UPDATES] = clampByte(stats->conn_param_updates);
+    }
+
+    const microbit_ble_link_totals_t *totals = uBit.ble->getLinkTotals();
+    diag[DIAG_LAST_DISCONNECT] = totals->last_disconnect_reason;
+    diag[DIAG_DISCONNECTS] = clampByte(totals->disconnects);
+    diag[DIAG_LINKS] = (uBit.ble->getPreferredPhy() << 4) | (uBit.ble->getPeripheralConnectionCount() & 0x0F);
+}
+
+void returnLinkDiagnostics(uint16_t handle)
+{
+    uint8_t diag[DIAGNOSTICS_LENGTH];
+    assembleLinkDiagnostics(handle, diag);
+    bleLinkSend(handle, diag, DIAGNOSTICS_LENGTH);
+}
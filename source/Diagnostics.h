@@ -0,0 +1,29 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include "BirdBrain.h"
+
+#define DIAGNOSTICS_LENGTH                        19 // no sensor report is this long, so the app can tell the reply apart by its length and opcode
+
+// Link diagnostics packet, sent in reply to LINK_DIAGNOSTICS. Counters marked "low 16 bits" wrap,
+// so the app should look at the difference between two reads rather than the raw value
+#define DIAG_OPCODE                               0  // LINK_DIAGNOSTICS. A Finch sensor packet can start with 0xC9 too, so check the length as well
+#define DIAG_CONN_INTERVAL                        1  // 2 bytes, MSB first, in 1.25 ms units
+#define DIAG_SLAVE_LATENCY                        3
+#define DIAG_RSSI_AVG                             4  // signed dBm, 0 if we haven't had a sample yet
+#define DIAG_RSSI_MIN                             5  // signed dBm
+#define DIAG_PHY                                  6  // TX PHY in the upper nibble, RX PHY in the lower, 1 = 1M, 2 = 2M
+#define DIAG_MAX_TX_OCTETS                        7  // link layer payload size in each direction
+#define DIAG_MAX_RX_OCTETS                        8
+#define DIAG_HVN_QUEUE_FULL                       9  // 2 bytes, low 16 bits, notifications refused because the queue was full
+#define DIAG_HVN_QUEUED                           11 // 2 bytes, low 16 bits, notifications handed to the SoftDevice
+#define DIAG_HVN_COMPLETE                         13 // 2 bytes, low 16 bits, notifications actually sent
+#define DIAG_LAST_DISCONNECT                      15 // HCI reason code of the last disconnect, e.g. 0x08 supervision timeout
+#define DIAG_DISCONNECTS                          16 // disconnects since boot, stops at 255
+#define DIAG_LINKS                                17 // apps connected right now in the lower nibble, the PHY we ask for (1 = 1M, 2 = 2M) in the upper
+#define DIAG_CONN_PARAM_UPDATES                   18 // connection parameter updates on this link, stops at 255
+
+void assembleLinkDiagnostics(uint16_t handle, uint8_t (&diag)[DIAGNOSTICS_LENGTH]); // Packs the link statistics for one connection
+void returnLinkDiagnostics(uint16_t handle); // Sends the link statistics to the app that asked
+
+#endif
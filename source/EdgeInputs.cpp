@@ -0,0 +1,92 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "EdgeInputs.h"
+
+// Averages every buffer the ADC hands over for one pin. Runs in the ADC interrupt, as the microphone's stream does
+class EdgeSampler : public DataSink
+{
+    public:
+    DataSource *source;
+    volatile uint16_t level;                      // 0-1023, as getAnalogValue() would give
+    volatile uint32_t updated;                    // system time of the last buffer
+    volatile bool valid;
+
+    EdgeSampler() : source(NULL), level(0), updated(0), valid(false) {}
+    virtual int pullRequest();
+};
+
+static EdgeSampler samplers[EDGE_INPUTS];
+
+int EdgeSampler::pullRequest()
+{
+    if(source == NULL)
+        return DEVICE_OK;
+
+    ManagedBuffer buffer = source->pull();
+    int format = source->getFormat();
+    if(format == DATASTREAM_FORMAT_UNKNOWN)
+        return DEVICE_OK;
+
+    int bytesPerSample = DATASTREAM_FORMAT_BYTES_PER_SAMPLE(format);
+    int samples = buffer.length() / bytesPerSample;
+    if(samples == 0)
+        return DEVICE_OK;
+
+    int32_t total = 0;
+    uint8_t *data = &buffer[0];
+    for(int i = 0; i < samples; i++)
+    {
+        total += StreamNormalizer::readSample[format](data);
+        data += bytesPerSample;
+    }
+
+    // Noise near 0 V can read slightly negative
+    int32_t average = (total / samples) >> EDGE_SAMPLE_SHIFT;
+    if(average < 0)
+        average = 0;
+    else if(average > EDGE_SAMPLE_MAX)
+        average = EDGE_SAMPLE_MAX;
+
+    level = average;
+    updated = uBit.systemTime();
+    valid = true;
+    return DEVICE_OK;
+}
+
+void edgeInputEnable(uint8_t pin)
+{
+    if(pin >= EDGE_INPUTS)
+        return;
+
+    NRF52ADCChannel *channel = uBit.adc.getChannel(uBit.io.pin[pin]);
+    if(channel == NULL)
+        return;
+    if(samplers[pin].source == &channel->output)
+        return; // the apps resend the pin modes with every command
+    if(samplers[pin].source != NULL)
+        samplers[pin].source->disconnect(); // the pin was given a different channel since we connected
+    samplers[pin].valid = false;
+    samplers[pin].source = &channel->output;
+    channel->output.connect(samplers[pin]);
+}
+
+void edgeInputDisable(uint8_t pin)
+{
+    if(pin >= EDGE_INPUTS || samplers[pin].source == NULL)
+        return;
+
+    // The pin gives up its ADC channel when it becomes an output, so let go of the stream first
+    samplers[pin].source->disconnect();
+    samplers[pin].source = NULL;
+    samplers[pin].valid = false;
+}
+
+bool edgeInputRead(uint8_t pin, uint16_t &value)
+{
+    if(pin >= EDGE_INPUTS || !samplers[pin].valid)
+        return false;
+    if(uBit.systemTime() - samplers[pin].updated > EDGE_SAMPLE_STALE)
+        return false;
+    value = samplers[pin].level;
+    return true;
+}
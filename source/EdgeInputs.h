@@ -0,0 +1,17 @@
+#ifndef EDGEINPUTS_H
+#define EDGEINPUTS_H
+
+#include "BirdBrain.h"
+
+// The ADC already scans every active channel with EasyDMA on its own timer. We take each buffer it delivers for an
+// edge connector input and average it into one reading, so reports read a snapshot instead of waiting on a conversion
+#define EDGE_INPUTS                               3  // pins 0, 1 and 2
+#define EDGE_SAMPLE_SHIFT                         4  // the ADC works in 14 bits, getAnalogValue() in 10
+#define EDGE_SAMPLE_MAX                           1023
+#define EDGE_SAMPLE_STALE                         100 // ms, reports convert the pin themselves if no buffer has arrived for this long
+
+void edgeInputEnable(uint8_t pin); // Starts averaging a pin that has just been set as an analog input
+void edgeInputDisable(uint8_t pin); // Stops before the pin is used as an output
+bool edgeInputRead(uint8_t pin, uint16_t &value); // Latest average, 0-1023, false if there isn't a recent one
+
+#endif
@@ -14,7 +14,9 @@ bool leftMotorForwardDirection = false ;
 bool rightMotorMove     = false ;
 bool rightMotorForwardDirection = false ;
 
-uint8_t prevFinchSetAllLEDs[FINCH_SETALL_LENGTH];
+static EncoderTrack leftTrack; // wrap and direction tracking for each wheel
+static EncoderTrack rightTrack;
+static uint32_t encoderSampleTime = 0; // system time of the last encoder sample
 
 // Helper function to record how we're setting the motors
 void moveMotor(uint8_t* currentCommand);
@@ -24,50 +26,35 @@ void initFinch()
 {
     stopFinch();
     resetEncoders();
-    // Init the previous Finch LED command array
-    memset(prevFinchSetAllLEDs, 0, FINCH_SETALL_LENGTH);
 }
 
 // Sends the stop command to the Finch
 void stopFinch()
 {
+    finchMotionCancel(); // otherwise the control loop would start the wheels again
+    motionQueueClear();
     uint8_t stopCommand[FINCH_SPI_LENGTH];
     
     memset(stopCommand, 0xFF, FINCH_SPI_LENGTH);
     stopCommand[0] = FINCH_STOPALL;
     spiWrite(stopCommand, FINCH_SPI_LENGTH);
-    // Init the previous Finch LED command array to all 0s
-    memset(prevFinchSetAllLEDs, 0, FINCH_SETALL_LENGTH);
+    actuatorCacheInvalidate(); // the LEDs and motors are off now, whatever we last sent
 }
 
 // Sets all Finch LEDs + buzzer in one go
 void setAllFinchLEDs(uint8_t commands[], uint8_t length)
 {
-    /*bool updateCommand = false;
-
-    // Checking if we've already set the LEDs to the same values, since Android loves to hammer us with this command
-    // Commented out as this caused more problems than it solved
-    for(int i = 0; i < FINCH_SETALL_LENGTH; i++)
-    {
-        if(commands[i] != prevFinchSetAllLEDs[i])
-        {
-            updateCommand = true;
-        }
-        prevFinchSetAllLEDs[i] = commands[i];
-    }*/
-
-    // Double check that the command contains enough data for us to proceed and that it isn't
-    // an identical command from one sent previously
+    // Double check that the command contains enough data for us to proceed
     if(length >= FINCH_SETALL_LENGTH)
     {    
-        // setting the buzzer
+        // setting the buzzer, every time as each command starts a new note
         uint16_t buzzPeriod = (commands[16]<<8) + commands[17];
         uint16_t buzzDuration = (commands[18]<<8) + commands[19];
         setBuzzer(buzzPeriod, buzzDuration);
 
-        // setting the Finch LEDs
-        //if(updateCommand)
-        spiWrite(commands, FINCH_SPI_LENGTH);
+        // setting the Finch LEDs, unless the Finch already has them. Android loves to hammer us with this command
+        if(actuatorCacheUpdate(CACHE_FINCH_LEDS, commands, FINCH_SPI_LENGTH))
+            spiWrite(commands, FINCH_SPI_LENGTH);
     }
 }
 
@@ -84,6 +71,13 @@ uint8_t setAllFinchMotorsAndLEDArray(uint8_t commands[], uint8_t length)
         // Use only the top 3 bits to determine mode
         mode = (commands[1]>>5) & LED_MOTOR_MODE_MASK;
 
+        // The app is driving the wheels itself now
+        if(mode >= MOTORS)
+        {
+            finchMotionCancel();
+            motionQueueClear();
+        }
+
         switch(mode)
         {
             case PRINT:
@@ -96,8 +90,7 @@ uint8_t setAllFinchMotorsAndLEDArray(uint8_t commands[], uint8_t length)
                 // checking that we have enough data to set the screen
                 if(length >= 6)
                 {
-                    commands[1] = SYMBOL; // Changing the command to one decodeAndSetDisplay understands
-                    decodeAndSetDisplay(commands, length);
+                    setDisplaySymbol(&commands[2]);
                     bytesUsed = 6;
                 }
                 break;
@@ -113,15 +106,7 @@ uint8_t setAllFinchMotorsAndLEDArray(uint8_t commands[], uint8_t length)
                 // Checking that we have enough data to set the motor and LED screen
                 if(length >= 14)
                 {
-                    uint8_t symbolCommands[6];
-                    // creating the symbol command set
-                    symbolCommands[0] = commands[0];
-                    symbolCommands[1] = SYMBOL;
-                    for(int i = 0; i < 4; i++)
-                    {
-                        symbolCommands[i+2] = commands[i+10];
-                    }
-                    decodeAndSetDisplay(symbolCommands, 6);
+                    setDisplaySymbol(&commands[10]);
                     moveMotor(commands); // safe to send the symbol commands too, they get overwritten with zeros
                     bytesUsed = 14;
                 }
@@ -157,6 +142,7 @@ void resetEncoders()
 {
     leftEncoder = 0;
     rightEncoder = 0;
+    odometryReset(); // the encoders are our odometry origin
     // Do we also need to reset the encoder on the Finch SAMD chip?
 }
 
@@ -168,25 +154,72 @@ void turnOffFinch()
     memset(turnOffCommand, 0xFF, FINCH_SPI_LENGTH);
     turnOffCommand[0] = FINCH_POWEROFF_SAMD;
 
-    spiWrite(turnOffCommand, FINCH_SPI_LENGTH);       
+    spiWrite(turnOffCommand, FINCH_SPI_LENGTH);
+    actuatorCacheInvalidate();
+}
+
+/************************************************************************/
+//Works out how far one wheel moved since the last sample
+//The SAMD counts ticks in either direction on a 24 bit counter, so the change is taken modulo 2^24. The counter
+//can't tell us which way the wheel turned, so the direction comes from what we told the wheel to do. After a change
+//of direction or a stop the wheel carries on the old way for a moment, so we keep the old direction until the wheel
+//has all but stopped. That is judged by its speed, so it doesn't matter how often we sample
+/************************************************************************/
+static int32_t encoderDelta(EncoderTrack *track, uint32_t counter, uint32_t now, bool move, bool commandedForward)
+{
+    uint32_t ticks = (counter - track->prevCounter) & FINCH_ENCODER_MASK;
+    uint32_t dt = now - track->prevTime;
+    bool primed = track->primed;
+
+    track->prevCounter = counter;
+    track->prevTime = now;
+    track->primed = true;
+
+    // The first value we see is just a starting point
+    if(!primed)
+        return 0;
+
+    // A counter that went backwards has been reset by the SAMD, e.g. a power cycle, so count from 0
+    if(ticks >= FINCH_ENCODER_HALF)
+    {
+        ticks = counter;
+        if(track->resets < 0xFFFF)
+            track->resets++;
+    }
+
+    if(move)
+    {
+        track->active = true;
+    }
+    else if(!track->active)
+    {
+        return 0; // stopped and settled, ignore any jitter on the counter
+    }
+
+    // Settled, so the wheel now turns the way it was told to. If the motor is off we stop counting
+    if((uint64_t)ticks * 1000 <= (uint64_t)FINCH_DIRECTION_SETTLE_RATE * dt)
+    {
+        track->forward = commandedForward;
+        if(!move)
+            track->active = false;
+    }
+
+    return track->forward ? (int32_t)ticks : -(int32_t)ticks;
 }
 
 /************************************************************************/
 //Function which updates the Encoder count value
-//Increases in one direction , decreases in another, based on the direction of the motor
-//Only active when the motors are moving
+//Increases in one direction , decreases in another, based on the direction the wheel is turning
+//Counts while the motors are moving, and while they coast to a stop
+//Also feeds the change into the odometry
 /************************************************************************/
-void arrangeFinchSensors(uint8_t (&spi_sensors_only)[FINCH_SPI_SENSOR_LENGTH], uint8_t (&sensor_vals)[FINCH_SENSOR_SEND_LENGTH])
+void updateFinchEncoders(uint8_t (&spi_sensors_only)[FINCH_SPI_SENSOR_LENGTH])
 {
-	uint8_t i = 0;
-	
-	static int32_t leftMotorChange      = 0;
+	int32_t leftMotorChange      = 0;
     uint32_t currentLeftCounterValue = 0;
-	static uint32_t prevLeftCounterValue = 0;
 	
-	static int32_t  rightMotorChange      = 0;
+	int32_t  rightMotorChange      = 0;
 	uint32_t currentRightCounterValue = 0;
-	static uint32_t prevRightCounterValue = 0;
 	
 	//Update the left counter based on the info got from SAMD
 	currentLeftCounterValue  = ((uint32_t)spi_sensors_only[9]<<16);
@@ -197,41 +230,82 @@ void arrangeFinchSensors(uint8_t (&spi_sensors_only)[FINCH_SPI_SENSOR_LENGTH], u
 	currentRightCounterValue |= (uint32_t)spi_sensors_only[13]<<8;
 	currentRightCounterValue |= (uint32_t)spi_sensors_only[14];
 	
-	
-	//Adust the encoders
-	//When the motors are moving , start considering the value
-	if(leftMotorMove == true)
-	{
-		//Get the change from previous value
-		leftMotorChange           = currentLeftCounterValue - prevLeftCounterValue ;
-		//Based on the direction of the motor add/substract the values
-		if(leftMotorForwardDirection == true )
-		{
-			leftEncoder  = leftEncoder + leftMotorChange;
-		}
-		else
-		{
-			leftEncoder  = leftEncoder - leftMotorChange;
-		}
-	}
-	prevLeftCounterValue = currentLeftCounterValue;
-	
-	if(rightMotorMove == true)
-	{
-		//Get the change from previous value
-		rightMotorChange       = currentRightCounterValue - prevRightCounterValue ;
-		//Based on the direction of the motor add/substract the values
-		if(rightMotorForwardDirection == true )
-		{
-			rightEncoder  = rightEncoder + rightMotorChange ;
-		}
-		else
-		{
-			rightEncoder  = rightEncoder - rightMotorChange;
-		}
-	}
-	prevRightCounterValue = currentRightCounterValue;
-	
+	uint32_t now = uBit.systemTime();
+	leftMotorChange = encoderDelta(&leftTrack, currentLeftCounterValue, now, leftMotorMove, leftMotorForwardDirection);
+	rightMotorChange = encoderDelta(&rightTrack, currentRightCounterValue, now, rightMotorMove, rightMotorForwardDirection);
+
+	leftEncoder  = leftEncoder + leftMotorChange;
+	rightEncoder  = rightEncoder + rightMotorChange;
+	encoderSampleTime = now;
+
+	odometryUpdate(leftMotorChange, rightMotorChange);
+}
+
+// [FINCH_REPORT_ENCODERS, left total (4 bytes), right total (4 bytes), flags, counter resets (2 bytes),
+//  time of the sample ms (4 bytes), light level, 0], all MSB first. The totals are the full 32 bit encoder values
+void assembleEncoderReport(uint8_t (&report)[FINCH_EXT_REPORT_LENGTH])
+{
+    uint16_t resets = leftTrack.resets + rightTrack.resets;
+
+    memset(report, 0, FINCH_EXT_REPORT_LENGTH);
+    report[0] = FINCH_REPORT_ENCODERS;
+    report[1] = (leftEncoder >> 24) & 0xFF;
+    report[2] = (leftEncoder >> 16) & 0xFF;
+    report[3] = (leftEncoder >> 8) & 0xFF;
+    report[4] = leftEncoder & 0xFF;
+    report[5] = (rightEncoder >> 24) & 0xFF;
+    report[6] = (rightEncoder >> 16) & 0xFF;
+    report[7] = (rightEncoder >> 8) & 0xFF;
+    report[8] = rightEncoder & 0xFF;
+    report[9] = (leftTrack.forward ? ENCODER_FLAG_LEFT_FORWARD : 0) | (rightTrack.forward ? ENCODER_FLAG_RIGHT_FORWARD : 0)
+              | (leftTrack.active ? ENCODER_FLAG_LEFT_ACTIVE : 0) | (rightTrack.active ? ENCODER_FLAG_RIGHT_ACTIVE : 0);
+    report[10] = resets >> 8;
+    report[11] = resets & 0xFF;
+    report[12] = (encoderSampleTime >> 24) & 0xFF;
+    report[13] = (encoderSampleTime >> 16) & 0xFF;
+    report[14] = (encoderSampleTime >> 8) & 0xFF;
+    report[15] = encoderSampleTime & 0xFF;
+    report[16] = uBit.display.readLightLevel();
+}
+
+// Reads the Finch sensors and updates the encoders and odometry, returns false if the read got interrupted
+bool finchSample()
+{
+    uint8_t spi_sensors_only[FINCH_SPI_SENSOR_LENGTH];
+    memset(spi_sensors_only, 0xFF, FINCH_SPI_SENSOR_LENGTH);
+
+    spiReadFinch(spi_sensors_only);
+
+    // Skip a read that was interrupted by an inbound BLE command, the next one picks up the ticks
+    if(spi_sensors_only[2] == 0x2C || spi_sensors_only[2] == 0xFF)
+        return false;
+
+    updateFinchEncoders(spi_sensors_only);
+    return true;
+}
+
+// Samples the Finch much faster than we send reports, so the odometry and motion control see every change in speed.
+// Only while someone needs it, otherwise the encoders are updated at the report rate by arrangeFinchSensors
+void finchSampleLoop()
+{
+    while(1)
+    {
+        bool needed = bleLinksReporting(LINK_REPORT_V3) || finchMotionRunning() || motionQueuePlaying();
+        if(whatAmI == A_FINCH && needed && finchSample())
+        {
+            finchMotionStep();
+            motionQueueStep();
+        }
+        fiber_sleep(FINCH_SAMPLE_PERIOD);
+    }
+}
+
+// arranges the encoder data and other data from SPI to prepare it to send over BLE
+void arrangeFinchSensors(uint8_t (&spi_sensors_only)[FINCH_SPI_SENSOR_LENGTH], uint8_t (&sensor_vals)[FINCH_SENSOR_SEND_LENGTH])
+{
+	uint8_t i = 0;
+
+	updateFinchEncoders(spi_sensors_only);
 	
 	for(i=0;i<7;i++)
 	{
@@ -251,6 +325,20 @@ void arrangeFinchSensors(uint8_t (&spi_sensors_only)[FINCH_SPI_SENSOR_LENGTH], u
 }
 
 
+// Sets the wheel speeds directly with no tick limit, from -FINCH_MAX_MOTOR_SPEED (backwards) to FINCH_MAX_MOTOR_SPEED
+void setFinchMotors(int8_t leftSpeed, int8_t rightSpeed)
+{
+    uint8_t command[FINCH_SPI_LENGTH];
+    memset(command, 0, FINCH_SPI_LENGTH);
+
+    command[0] = FINCH_SETALL_MOTORS_MLED;
+    command[1] = MOTORS << 5;
+    // Top bit is the direction, 0 stays 0 so the motor counts as stopped
+    command[2] = (leftSpeed > 0) ? (0x80 | leftSpeed) : -leftSpeed;
+    command[6] = (rightSpeed > 0) ? (0x80 | rightSpeed) : -rightSpeed;
+    moveMotor(command);
+}
+
 /************************************************************************/
 //Update movement flags as they are useful in getting a relative encoder tick count
 //Convert 32 bit number into a 24 bit value and send it to SAMD
@@ -312,6 +400,16 @@ void moveMotor(uint8_t* currentCommand)
             rightMotorMove = true;
         }
 
-        spiWrite(currentCommand,FINCH_SPI_LENGTH);
+        // Only the first 10 bytes matter to the motors, the rest can be a symbol or message for the LED array.
+        // A tick count starts a new move each time it is sent, so those always go out and leave the slot unknown
+        if(leftMotorTicks != 0 || rightMotorTicks != 0)
+        {
+            actuatorCacheInvalidate(CACHE_FINCH_MOTORS);
+            spiWrite(currentCommand,FINCH_SPI_LENGTH);
+        }
+        else if(actuatorCacheUpdate(CACHE_FINCH_MOTORS, currentCommand, 10))
+        {
+            spiWrite(currentCommand,FINCH_SPI_LENGTH);
+        }
     }
 }
\ No newline at end of file
@@ -14,6 +14,32 @@
 
 #define LED_MOTOR_MODE_MASK                         0x07
 
+#define FINCH_ENCODER_MASK                          0xFFFFFF                    //The SAMD's tick counters are 24 bits
+#define FINCH_ENCODER_HALF                          0x800000                    //A change this big means the counter was reset
+#define FINCH_DIRECTION_SETTLE_RATE                 100                         //ticks per second, a wheel this slow has stopped and can change direction
+
+// Extended report with the full 32 bit encoder totals, sent to V3 apps after the odometry report
+// The SAMD's counters only count ticks, not which way the wheel turned, so the FORWARD flags are the commanded direction
+// once the wheel has slowed below FINCH_DIRECTION_SETTLE_RATE. A wheel pushed backwards by hand, or one that reverses and
+// speeds up again between two samples, is still counted the way it was last settled
+#define FINCH_REPORT_ENCODERS                       0x02
+#define ENCODER_FLAG_LEFT_FORWARD                   0x01
+#define ENCODER_FLAG_RIGHT_FORWARD                  0x02
+#define ENCODER_FLAG_LEFT_ACTIVE                    0x04                        //still counting, moving or coasting
+#define ENCODER_FLAG_RIGHT_ACTIVE                   0x08
+
+// Tracks one wheel's tick counter from sample to sample
+typedef struct {
+    uint32_t prevCounter;                       // last 24 bit counter value from the SAMD
+    uint32_t prevTime;                          // system time of that value
+    bool primed;                                // false until we have seen a counter value
+    bool forward;                               // the way we think the wheel is actually turning
+    bool active;                                // counting ticks, false once the wheel has stopped with the motor off
+    uint16_t resets;                            // times the SAMD counter went back to 0 under us
+} EncoderTrack;
+
+#define FINCH_SAMPLE_PERIOD                         10                          //ms between encoder samples for the odometry
+
 // Initializes the Finch, mostly setting the edge connector pins as we want
 void initFinch();
 
@@ -26,12 +52,27 @@ void setAllFinchLEDs(uint8_t commands[], uint8_t length);
 // Sets all Finch motors + the micro:bit LED array. Returns the number of bytes that were used to set the outputs
 uint8_t setAllFinchMotorsAndLEDArray(uint8_t commands[], uint8_t length);
 
+// Sets the wheel speeds directly with no tick limit, from -FINCH_MAX_MOTOR_SPEED (backwards) to FINCH_MAX_MOTOR_SPEED
+void setFinchMotors(int8_t leftSpeed, int8_t rightSpeed);
+
 // Resets the Finch encoders
 void resetEncoders();
 
 // Turns off the Finch - in case we haven't received anything over BLE for 10 minutes
 void turnOffFinch();
 
+// Updates the running encoder values and the odometry from one SPI sensor read
+void updateFinchEncoders(uint8_t (&spi_sensors_only)[FINCH_SPI_SENSOR_LENGTH]);
+
+// Packs the full 32 bit encoder totals into an extended report
+void assembleEncoderReport(uint8_t (&report)[FINCH_EXT_REPORT_LENGTH]);
+
+// Reads the Finch sensors and updates the encoders and odometry, returns false if the read got interrupted
+bool finchSample();
+
+// Fiber that samples the Finch encoders every FINCH_SAMPLE_PERIOD ms
+void finchSampleLoop();
+
 // arranges the encoder data and other data from SPI to prepare it to send over BLE
 void arrangeFinchSensors(uint8_t (&spi_sensors_only)[FINCH_SPI_SENSOR_LENGTH], uint8_t (&sensor_vals)[FINCH_SENSOR_SEND_LENGTH]);
 
@@ -0,0 +1,206 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "Finch.h"
+#include "FinchMotion.h"
+
+static FinchMotion motion;
+
+static int32_t absVal(int32_t value)
+{
+    return value < 0 ? -value : value;
+}
+
+static int32_t clampVal(int32_t value, int32_t low, int32_t high)
+{
+    if(value < low)
+        return low;
+    if(value > high)
+        return high;
+    return value;
+}
+
+// Ticks a wheel travels when it goes round deg10 tenths of a degree of a circle of radius um
+static int32_t arcTicks(int32_t radius, int32_t deg10)
+{
+    return (int32_t)(((int64_t)deg10 * radius * 256 * 31416) / (1800LL * 10000 * ODOM_UM_PER_TICK_Q8));
+}
+
+// Ticks a wheel travels going mm millimetres in a straight line, rounded to the nearest tick
+static int32_t distanceTicks(int32_t mm)
+{
+    int64_t scaled = (int64_t)mm * 1000 * 256;
+    int64_t half = ODOM_UM_PER_TICK_Q8/2;
+    return (int32_t)((scaled < 0 ? scaled - half : scaled + half) / ODOM_UM_PER_TICK_Q8);
+}
+
+static int16_t readInt16(uint8_t *buf)
+{
+    return (int16_t)((buf[0] << 8) | buf[1]);
+}
+
+// Only talks to the SAMD when a speed actually changes
+static void setSpeeds(int8_t left, int8_t right)
+{
+    if(left != motion.lastLeftSpeed || right != motion.lastRightSpeed)
+    {
+        setFinchMotors(left, right);
+        motion.lastLeftSpeed = left;
+        motion.lastRightSpeed = right;
+    }
+}
+
+static void finish(uint8_t status)
+{
+    motion.state = MOTION_IDLE;
+
+    if(bleuart->getConnected(motion.link))
+    {
+        int32_t leftError = motion.left.target - (leftEncoder - motion.left.start);
+        int32_t rightError = motion.right.target - (rightEncoder - motion.right.start);
+        uint8_t report[MOTION_REPORT_LENGTH];
+        report[0] = FINCH_MOTION;
+        report[1] = motion.id;
+        report[2] = status;
+        report[3] = (uint8_t)(int8_t)clampVal(leftError, -128, 127);
+        report[4] = (uint8_t)(int8_t)clampVal(rightError, -128, 127);
+        bleLinkSend(motion.link, report, MOTION_REPORT_LENGTH);
+    }
+}
+
+// PID on how far a wheel is behind where it should be, in speed units
+static int32_t wheelCorrection(MotionWheel *wheel, int32_t desired, int32_t actual)
+{
+    int32_t error = desired - actual;
+    wheel->integral = clampVal(wheel->integral + error, -MOTION_I_LIMIT, MOTION_I_LIMIT);
+    int32_t derivative = error - wheel->lastError;
+    wheel->lastError = error;
+    return (MOTION_KP*error + MOTION_KI*wheel->integral + MOTION_KD*derivative) >> MOTION_PID_SHIFT;
+}
+
+void finchMotionStart(int32_t leftTicks, int32_t rightTicks, uint8_t speed, uint8_t id, uint16_t link)
+{
+    if(motion.state == MOTION_RUNNING)
+        finish(MOTION_CANCELLED);
+    motionQueueClear(); // we own the wheels now
+
+    memset(&motion, 0, sizeof(motion));
+    motion.id = id;
+    motion.link = link;
+    motion.cruise = clampVal(speed, MOTION_MIN_SPEED, FINCH_MAX_MOTOR_SPEED);
+    motion.left.target = leftTicks;
+    motion.left.start = leftEncoder;
+    motion.right.target = rightTicks;
+    motion.right.start = rightEncoder;
+    motion.lastProgressTime = uBit.systemTime();
+    motion.lastLeftSpeed = 0x7F; // not a real speed, forces the first write
+    motion.lastRightSpeed = 0x7F;
+
+    if(absVal(leftTicks) <= MOTION_TOLERANCE && absVal(rightTicks) <= MOTION_TOLERANCE)
+    {
+        finish(MOTION_DONE);
+        return;
+    }
+    motion.state = MOTION_RUNNING;
+    finchMotionStep();
+}
+
+// The wheel with further to go leads, and sets the speed from how far it has left. The other wheel follows
+// it proportionally, with the PID making up any difference, so both wheels arrive together
+void finchMotionStep()
+{
+    if(motion.state != MOTION_RUNNING)
+        return;
+
+    int32_t leftDone = leftEncoder - motion.left.start;
+    int32_t rightDone = rightEncoder - motion.right.start;
+
+    bool leftLeads = absVal(motion.left.target) >= absVal(motion.right.target);
+    int32_t leadTarget = leftLeads ? motion.left.target : motion.right.target;
+    int32_t leadDone = leftLeads ? leftDone : rightDone;
+    int32_t leadLength = absVal(leadTarget);
+    int32_t progress = (leadTarget < 0) ? -leadDone : leadDone; // along the direction we want to go
+    int32_t remaining = leadLength - progress;
+
+    if(remaining <= MOTION_TOLERANCE)
+    {
+        setSpeeds(0, 0);
+        finish(MOTION_DONE);
+        return;
+    }
+
+    uint32_t now = uBit.systemTime();
+    if(progress > motion.bestProgress)
+    {
+        motion.bestProgress = progress;
+        motion.lastProgressTime = now;
+    }
+    else if(now - motion.lastProgressTime > MOTION_STALL_TIME)
+    {
+        setSpeeds(0, 0);
+        finish(MOTION_STALLED);
+        return;
+    }
+
+    // Cruise, then slow down as we get close so we don't overshoot
+    int32_t base = clampVal(remaining / MOTION_RAMP_TICKS, MOTION_MIN_SPEED, motion.cruise);
+
+    // Where each wheel should be, given how far along the leading wheel is
+    int32_t fraction = (int32_t)(((int64_t)clampVal(progress, 0, leadLength) << 16) / leadLength);
+    int32_t leftDesired = (int32_t)(((int64_t)motion.left.target * fraction) >> 16);
+    int32_t rightDesired = (int32_t)(((int64_t)motion.right.target * fraction) >> 16);
+
+    // The leading wheel defines where we are, so only the follower needs correcting
+    int32_t leftSpeed = (base * motion.left.target) / leadLength;
+    int32_t rightSpeed = (base * motion.right.target) / leadLength;
+    if(leftLeads)
+        rightSpeed += wheelCorrection(&motion.right, rightDesired, rightDone);
+    else
+        leftSpeed += wheelCorrection(&motion.left, leftDesired, leftDone);
+
+    setSpeeds(clampVal(leftSpeed, -FINCH_MAX_MOTOR_SPEED, FINCH_MAX_MOTOR_SPEED),
+              clampVal(rightSpeed, -FINCH_MAX_MOTOR_SPEED, FINCH_MAX_MOTOR_SPEED));
+}
+
+void finchMotionCancel()
+{
+    if(motion.state == MOTION_RUNNING)
+        finish(MOTION_CANCELLED);
+}
+
+bool finchMotionRunning()
+{
+    return motion.state == MOTION_RUNNING;
+}
+
+void finchMotionCommand(uint8_t commands[], uint8_t length, uint16_t link)
+{
+    if(length < FINCH_MOTION_LENGTH)
+        return;
+
+    int32_t a = readInt16(&commands[2]);
+    int32_t b = readInt16(&commands[4]);
+    uint8_t speed = commands[6];
+    uint8_t id = commands[7];
+    int32_t halfTrack = ODOM_TRACK_UM/2;
+
+    switch(commands[1])
+    {
+        case MOTION_STOP:
+            finchMotionCancel();
+            motionQueueClear(); // stop means everything, not just the move in progress
+            setFinchMotors(0, 0);
+            break;
+        case MOTION_DRIVE:
+        {
+            int32_t ticks = distanceTicks(a);
+            finchMotionStart(ticks, ticks, speed, id, link);
+            break;
+        }
+        case MOTION_TURN:
+            finchMotionStart(arcTicks(-halfTrack, a), arcTicks(halfTrack, a), speed, id, link);
+            break;
+        case MOTION_ARC:
+            finchMotionStart(arcTicks(a*1000 - halfTrack, b), arcTicks(a*1000 + halfTrack, b), speed, id, link);
+            break;
+    }
+}
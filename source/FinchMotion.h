@@ -0,0 +1,63 @@
+#ifndef FINCHMOTION_H
+#define FINCHMOTION_H
+
+#include "BirdBrain.h"
+
+// FINCH_MOTION command: [FINCH_MOTION, type, a (2 bytes), b (2 bytes), speed, id], values MSB first
+#define FINCH_MOTION_LENGTH                       8
+#define MOTION_STOP                               0x00 // cancels the current motion and stops the wheels
+#define MOTION_DRIVE                              0x01 // a = distance in mm, negative drives backwards
+#define MOTION_TURN                               0x02 // a = angle in 0.1 degrees, positive turns left (counter clockwise)
+#define MOTION_ARC                                0x03 // a = radius in mm, positive when the centre of the circle is to our left
+                                                       // b = heading change in 0.1 degrees, positive counter clockwise. We drive forwards when a and b have the same sign
+
+// Completion notification: [FINCH_MOTION, id, status, left error, right error], errors in ticks clamped to a signed byte
+#define MOTION_REPORT_LENGTH                      5
+#define MOTION_DONE                               0
+#define MOTION_CANCELLED                          1 // replaced by another motor command, or stopped
+#define MOTION_STALLED                            2 // the wheels stopped moving before we got there
+
+// Motor speeds, in the units of the Finch motor command. FINCH_MAX_MOTOR_SPEED is 100% in the apps
+#define FINCH_MAX_MOTOR_SPEED                     36
+#define MOTION_MIN_SPEED                          5  // slowest speed that still reliably moves the Finch
+#define MOTION_RAMP_TICKS                         12 // slow down by one speed unit for every this many ticks short of the target
+
+// Control loop, runs every FINCH_SAMPLE_PERIOD. Gains are numerators over 2^MOTION_PID_SHIFT
+#define MOTION_PID_SHIFT                          4
+#define MOTION_KP                                 6
+#define MOTION_KI                                 1
+#define MOTION_KD                                 4
+#define MOTION_I_LIMIT                            200 // ticks, stops the integral winding up while a wheel is held
+#define MOTION_TOLERANCE                          4   // ticks from the target that count as there, under a mm
+#define MOTION_STALL_TIME                         500 // ms without progress before we give up
+
+#define MOTION_IDLE                               0
+#define MOTION_RUNNING                            1
+
+typedef struct {
+    int32_t target;                               // ticks this wheel has to travel, signed
+    int32_t start;                                // encoder value when the motion started
+    int32_t integral;
+    int32_t lastError;
+} MotionWheel;
+
+typedef struct {
+    uint8_t state;
+    uint8_t id;                                   // echoed back in the completion notification
+    uint16_t link;                                // connection that asked for the motion, gets the completion notification
+    uint8_t cruise;                               // speed once we're away from the target
+    MotionWheel left;
+    MotionWheel right;
+    int32_t bestProgress;                         // furthest the leading wheel has got, for stall detection
+    uint32_t lastProgressTime;
+    int8_t lastLeftSpeed;                         // what we last sent, so we only write to the SAMD on a change
+    int8_t lastRightSpeed;
+} FinchMotion;
+
+void finchMotionCommand(uint8_t commands[], uint8_t length, uint16_t link); // Decodes a FINCH_MOTION command and starts it
+void finchMotionStart(int32_t leftTicks, int32_t rightTicks, uint8_t speed, uint8_t id, uint16_t link); // Drives each wheel a number of ticks, in sync
+void finchMotionStep(); // Runs one iteration of the control loop, called after every encoder sample
+void finchMotionCancel(); // Stops controlling the motors, e.g. because the app sent a motor command of its own
+bool finchMotionRunning();
+
+#endif
@@ -0,0 +1,150 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "SpiControl.h"
+#include "HBSensors.h"
+
+static HBSensorFilter filters[HB_SENSOR_PORTS];
+static bool filtersInitialized = false;
+static uint32_t lastSample = 0; // system time of the last good sample
+
+static void initFilters()
+{
+    for(int i = 0; i < HB_SENSOR_PORTS; i++)
+    {
+        filters[i].filter = HB_DEFAULT_FILTER;
+        filters[i].setting = HB_DEFAULT_SETTING;
+    }
+    filtersInitialized = true;
+    hbSensorsReset();
+}
+
+static void addSample(HBSensorFilter *f, uint8_t value)
+{
+    f->samples[f->next] = value;
+    f->next = (f->next + 1) % HB_FILTER_WINDOW;
+    if(f->count < HB_FILTER_WINDOW)
+        f->count++;
+
+    // Start the exponential filter at the first sample rather than ramping up from 0
+    if(f->count == 1)
+        f->smoothed = value << 8;
+    else
+        f->smoothed += ((int32_t)(value << 8) - (int32_t)f->smoothed) >> f->setting;
+}
+
+// Value of a filter from its most recent samples
+static uint8_t filterValue(HBSensorFilter *f)
+{
+    uint8_t n = (f->setting < f->count) ? f->setting : f->count;
+    uint8_t recent[HB_FILTER_WINDOW];
+
+    if(f->count == 0)
+        return 0;
+
+    for(int i = 0; i < n; i++)
+        recent[i] = f->samples[(f->next + HB_FILTER_WINDOW - 1 - i) % HB_FILTER_WINDOW];
+
+    switch(f->filter)
+    {
+        case HB_FILTER_AVERAGE:
+        {
+            uint16_t sum = 0;
+            for(int i = 0; i < n; i++)
+                sum += recent[i];
+            return (sum + n/2) / n;
+        }
+        case HB_FILTER_MEDIAN:
+            // Insertion sort, there are never more than HB_FILTER_WINDOW samples
+            for(int i = 1; i < n; i++)
+            {
+                uint8_t value = recent[i];
+                int j = i - 1;
+                while(j >= 0 && recent[j] > value)
+                {
+                    recent[j+1] = recent[j];
+                    j--;
+                }
+                recent[j+1] = value;
+            }
+            return recent[n/2];
+        case HB_FILTER_EXPONENTIAL:
+            return (f->smoothed + 128) >> 8;
+        default:
+            return recent[0];
+    }
+}
+
+void hbSensorFilterCommand(uint8_t commands[], uint8_t length)
+{
+    if(!filtersInitialized)
+        initFilters();
+
+    if(length < HB_FILTER_LENGTH || commands[1] < 1 || commands[1] > HB_SENSOR_PORTS)
+        return;
+
+    HBSensorFilter *f = &filters[commands[1] - 1];
+    uint8_t filter = commands[2];
+    uint8_t setting = commands[3];
+
+    switch(filter)
+    {
+        case HB_FILTER_AVERAGE:
+        case HB_FILTER_MEDIAN:
+            if(setting < 1 || setting > HB_FILTER_WINDOW)
+                return;
+            break;
+        case HB_FILTER_EXPONENTIAL:
+            if(setting < 1 || setting > HB_FILTER_MAX_SHIFT)
+                return;
+            f->smoothed = filterValue(f) << 8; // carry on from where the old filter was
+            break;
+        case HB_FILTER_NONE:
+            setting = 1;
+            break;
+        default:
+            return;
+    }
+    f->filter = filter;
+    f->setting = setting;
+}
+
+void hbSensorsReset()
+{
+    for(int i = 0; i < HB_SENSOR_PORTS; i++)
+    {
+        filters[i].count = 0;
+        filters[i].next = 0;
+    }
+    lastSample = 0;
+}
+
+bool hbSensorsFiltered(uint8_t (&values)[V2_SENSOR_SEND_LENGTH])
+{
+    if(!filtersInitialized || lastSample == 0 || uBit.systemTime() - lastSample > HB_SAMPLE_STALE)
+        return false;
+
+    for(int i = 0; i < HB_SENSOR_PORTS; i++)
+        values[i] = filterValue(&filters[i]);
+    return true;
+}
+
+void hbSampleLoop()
+{
+    if(!filtersInitialized)
+        initFilters();
+
+    while(1)
+    {
+        if(whatAmI == A_HB && notifyOn)
+        {
+            uint8_t raw[V2_SENSOR_SEND_LENGTH];
+            if(spiReadHB(raw))
+            {
+                for(int i = 0; i < HB_SENSOR_PORTS; i++)
+                    addSample(&filters[i], raw[i]);
+                lastSample = uBit.systemTime();
+            }
+        }
+        fiber_sleep(HB_SAMPLE_PERIOD);
+    }
+}
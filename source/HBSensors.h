@@ -0,0 +1,38 @@
+#ifndef HBSENSORS_H
+#define HBSENSORS_H
+
+#include "BirdBrain.h"
+
+// HB_SENSOR_FILTER command: [HB_SENSOR_FILTER, port (1-4, 4 is the battery), filter, setting]
+#define HB_FILTER_LENGTH                          4
+#define HB_FILTER_NONE                            0x00 // the latest sample
+#define HB_FILTER_AVERAGE                         0x01 // setting is the number of samples, 1 to HB_FILTER_WINDOW
+#define HB_FILTER_MEDIAN                          0x02 // setting is the number of samples, 1 to HB_FILTER_WINDOW
+#define HB_FILTER_EXPONENTIAL                     0x03 // setting is the shift, each sample moves the value 1/2^setting of the way, 1 to HB_FILTER_MAX_SHIFT
+
+#define HB_SENSOR_PORTS                           4  // three sensor ports and the battery, in the order spiReadHB returns them
+#define HB_FILTER_WINDOW                          8
+#define HB_FILTER_MAX_SHIFT                       4
+
+// Defaults, a median throws away the odd corrupted SPI read as well as smoothing
+#define HB_DEFAULT_FILTER                         HB_FILTER_MEDIAN
+#define HB_DEFAULT_SETTING                        5
+
+#define HB_SAMPLE_PERIOD                          8   // ms between samples, about four per sensor report
+#define HB_SAMPLE_STALE                           100 // ms, reports read the SPI themselves if the sampler hasn't run for this long
+
+typedef struct {
+    uint8_t filter;
+    uint8_t setting;
+    uint8_t samples[HB_FILTER_WINDOW];            // ring buffer of raw samples
+    uint8_t count;                                // samples in the ring, up to the window
+    uint8_t next;                                 // where the next sample goes
+    uint16_t smoothed;                            // exponential filter state, times 256
+} HBSensorFilter;
+
+void hbSensorFilterCommand(uint8_t commands[], uint8_t length); // Decodes a HB_SENSOR_FILTER command
+void hbSensorsReset(); // Empties the filters, e.g. when a Hummingbird is plugged in, keeps the settings
+bool hbSensorsFiltered(uint8_t (&values)[V2_SENSOR_SEND_LENGTH]); // Fills in the first HB_SENSOR_PORTS values, false if the sampler isn't running
+void hbSampleLoop(); // Fiber that samples the sensor ports while notifications are on
+
+#endif
@@ -15,6 +15,8 @@ void initHB()
 
     // Sending a stop command just in case
     stopHB();
+    // Old samples may be from another Hummingbird
+    hbSensorsReset();
 }
 
 // Sends the stop command to the Hummingbird
@@ -22,6 +24,8 @@ void stopHB()
 {
     uint8_t stopCommand[4] = {STOP_ALL, 0xFF, 0xFF, 0xFF};
     spiWrite(stopCommand, 4);
+    actuatorCacheInvalidate();
+    servoMotionCancel();
     // Setting the buzzer, and HB LED ports 2 and 3 to 0
     uBit.io.P0.setAnalogValue(0);
     uBit.io.P2.setAnalogValue(0);
@@ -41,7 +45,16 @@ void setAllHB(uint8_t commands[], uint8_t length)
         uint16_t buzzPeriod = (commands[15]<<8) + commands[16];
         uint16_t buzzDuration = (commands[17]<<8) + commands[18];
         setBuzzer(buzzPeriod, buzzDuration);
-        // Sending the SPI command to control the remaining LEDs + servos - 13 bytes
-        spiWrite(commands, LENGTH_SETALL_SPI);
+        // Sending the SPI command to control the remaining LEDs + servos - 13 bytes, with any servos we are easing in their current positions
+        uint8_t frame[LENGTH_SETALL_SPI];
+        memcpy(frame, commands, LENGTH_SETALL_SPI);
+        servoMotionApply(frame);
+        writeHBOutputs(frame);
     }
+}
+
+void writeHBOutputs(uint8_t (&frame)[LENGTH_SETALL_SPI])
+{
+    if(actuatorCacheUpdate(CACHE_HB_OUTPUTS, frame, LENGTH_SETALL_SPI))
+        spiWrite(frame, LENGTH_SETALL_SPI);
 }
\ No newline at end of file
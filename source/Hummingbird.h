@@ -12,4 +12,7 @@ void stopHB();
 // Sets all Hummingbird outputs in one go
 void setAllHB(uint8_t commands[], uint8_t length);
 
+// Sends the LED and servo part of a setAll to the HB, unless it already has it
+void writeHBOutputs(uint8_t (&frame)[LENGTH_SETALL_SPI]);
+
 #endif
\ No newline at end of file
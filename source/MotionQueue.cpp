@@ -0,0 +1,134 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "Finch.h"
+#include "MotionQueue.h"
+
+static MotionSegment queue[MOTION_QUEUE_LENGTH];
+static uint8_t head = 0; // next segment to play
+static uint8_t count = 0; // segments waiting, not counting the one playing
+static bool playing = false;
+static MotionSegment current; // segment being played
+static uint32_t segmentStart = 0; // when the current segment was due to start, so timed segments don't drift
+static int32_t startLeft = 0; // encoders when the current segment started
+static int32_t startRight = 0;
+static uint16_t queueLink = BLE_CONN_HANDLE_INVALID; // app that started playback, gets the notifications
+
+static void notify(uint16_t link, uint8_t event, uint8_t id)
+{
+    if(!bleuart->getConnected(link))
+        return;
+    uint8_t report[SEGMENT_REPORT_LENGTH];
+    report[0] = FINCH_SEGMENTS;
+    report[1] = event;
+    report[2] = id;
+    report[3] = count;
+    bleLinkSend(link, report, SEGMENT_REPORT_LENGTH);
+}
+
+// Starts the next segment straight away, the wheels only stop when the queue runs dry
+static void startNext(uint32_t due)
+{
+    if(count == 0)
+    {
+        playing = false;
+        setFinchMotors(0, 0);
+        notify(queueLink, SEGMENT_DRAINED, current.id);
+        return;
+    }
+    current = queue[head];
+    head = (head + 1) % MOTION_QUEUE_LENGTH;
+    count--;
+
+    segmentStart = due;
+    startLeft = leftEncoder;
+    startRight = rightEncoder;
+    setFinchMotors(current.leftSpeed, current.rightSpeed);
+}
+
+static bool segmentDone(uint32_t now)
+{
+    uint32_t elapsed = now - segmentStart;
+    if(current.end == SEGMENT_END_TIME)
+        return elapsed >= current.value;
+
+    int32_t left = leftEncoder - startLeft;
+    int32_t right = rightEncoder - startRight;
+    if(left < 0) left = -left;
+    if(right < 0) right = -right;
+    return (left >= current.value) || (right >= current.value) || elapsed >= SEGMENT_TIMEOUT;
+}
+
+void motionQueueStep()
+{
+    if(!playing)
+        return;
+
+    uint32_t now = uBit.systemTime();
+    if(segmentDone(now))
+    {
+        // A timed segment ends when it was due to, not when we noticed, so a long routine keeps its rhythm
+        uint32_t due = (current.end == SEGMENT_END_TIME) ? segmentStart + current.value : now;
+        notify(queueLink, SEGMENT_DONE, current.id);
+        startNext(due);
+    }
+}
+
+void motionQueueClear()
+{
+    playing = false;
+    head = 0;
+    count = 0;
+}
+
+bool motionQueuePlaying()
+{
+    return playing;
+}
+
+void motionQueueCommand(uint8_t commands[], uint8_t length, uint16_t link)
+{
+    if(length < FINCH_SEGMENT_LENGTH)
+        return;
+
+    switch(commands[1])
+    {
+        case SEGMENT_ADD:
+        {
+            MotionSegment segment;
+            segment.id = commands[2];
+            segment.leftSpeed = (int8_t)commands[3];
+            segment.rightSpeed = (int8_t)commands[4];
+            segment.end = commands[5];
+            segment.value = (commands[6] << 8) | commands[7];
+            // Keep speeds in range so a bad packet can't send the SAMD a reversed direction
+            if(segment.leftSpeed > FINCH_MAX_MOTOR_SPEED) segment.leftSpeed = FINCH_MAX_MOTOR_SPEED;
+            if(segment.leftSpeed < -FINCH_MAX_MOTOR_SPEED) segment.leftSpeed = -FINCH_MAX_MOTOR_SPEED;
+            if(segment.rightSpeed > FINCH_MAX_MOTOR_SPEED) segment.rightSpeed = FINCH_MAX_MOTOR_SPEED;
+            if(segment.rightSpeed < -FINCH_MAX_MOTOR_SPEED) segment.rightSpeed = -FINCH_MAX_MOTOR_SPEED;
+
+            // Tell whoever sent the segment, the app that started playback keeps its notifications
+            if(count >= MOTION_QUEUE_LENGTH)
+            {
+                notify(link, SEGMENT_FULL, segment.id);
+                break;
+            }
+            queue[(head + count) % MOTION_QUEUE_LENGTH] = segment;
+            count++;
+            break;
+        }
+        case SEGMENT_START:
+            if(!playing && count > 0)
+            {
+                queueLink = link;
+                finchMotionCancel(); // the queue owns the wheels now
+                playing = true;
+                startNext(uBit.systemTime());
+            }
+            break;
+        case SEGMENT_CLEAR:
+            if(playing)
+                setFinchMotors(0, 0);
+            motionQueueClear();
+            break;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef MOTIONQUEUE_H
+#define MOTIONQUEUE_H
+
+#include "BirdBrain.h"
+
+// FINCH_SEGMENTS command, always FINCH_SEGMENT_LENGTH bytes: [FINCH_SEGMENTS, op, id, left speed, right speed, end, value (2 bytes, MSB first)]
+// Speeds are signed, -FINCH_MAX_MOTOR_SPEED to FINCH_MAX_MOTOR_SPEED
+#define FINCH_SEGMENT_LENGTH                      8
+#define SEGMENT_ADD                               0x01 // appends a segment, playback starts with SEGMENT_START so a routine can be preloaded
+#define SEGMENT_START                             0x02
+#define SEGMENT_CLEAR                             0x03 // stops playback, stops the wheels and empties the queue
+
+#define SEGMENT_END_TIME                          0x00 // value is the duration in ms
+#define SEGMENT_END_TICKS                         0x01 // value is how far the faster wheel travels, in ticks
+
+// Notifications: [FINCH_SEGMENTS, event, id, segments left in the queue]
+#define SEGMENT_REPORT_LENGTH                     4
+#define SEGMENT_DONE                              0x01
+#define SEGMENT_DRAINED                           0x02 // the last segment finished and the wheels have stopped
+#define SEGMENT_FULL                              0x03 // the segment was dropped
+
+#define MOTION_QUEUE_LENGTH                       16
+#define SEGMENT_TIMEOUT                           10000 // ms, a tick segment on a stuck wheel gives up after this
+
+typedef struct {
+    uint8_t id;
+    int8_t leftSpeed;
+    int8_t rightSpeed;
+    uint8_t end;                                  // SEGMENT_END_TIME or SEGMENT_END_TICKS
+    uint16_t value;
+} MotionSegment;
+
+void motionQueueCommand(uint8_t commands[], uint8_t length, uint16_t link); // Decodes a FINCH_SEGMENTS command
+void motionQueueStep(); // Moves on to the next segment when the current one is done, called after every encoder sample
+void motionQueueClear(); // Stops playback and empties the queue, leaves the wheels as they are
+bool motionQueuePlaying();
+
+#endif
@@ -0,0 +1,158 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "Odometry.h"
+
+static OdometryState odom;
+static uint8_t compassCount = 0; // samples since we last looked at the compass
+static bool compassReferenced = false; // true once we know which compass heading our heading 0 corresponds to
+static uint32_t compassOffset = 0; // compass heading minus odometry heading, as binary angles
+
+// Quarter of a sine wave in 64 steps, scaled to 32767
+static const int16_t sineTable[65] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393, 7179, 7962, 8739, 9512,
+    10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868,
+    19519, 20159, 20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811, 25329, 25832, 26319,
+    26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956, 30273, 30571, 30852, 31113,
+    31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757, 32767
+};
+
+// Sine of a binary angle, scaled to 32767, interpolating between table entries
+static int32_t sinQ15(uint32_t angle)
+{
+    uint32_t quadrant = angle >> 30;
+    uint32_t pos = (angle >> 14) & 0xFFFF; // position within the quadrant
+    if(quadrant & 1)
+        pos = 0x10000 - pos; // second and fourth quadrants run the table backwards
+
+    uint32_t index = pos >> 10;
+    int32_t frac = pos & 0x3FF;
+    int32_t a = sineTable[index];
+    int32_t b = (index < 64) ? sineTable[index+1] : a;
+    int32_t value = a + (((b - a) * frac) >> 10);
+
+    return (quadrant & 2) ? -value : value;
+}
+
+static int32_t cosQ15(uint32_t angle)
+{
+    return sinQ15(angle + ODOM_BAM_QUARTER);
+}
+
+// Divides by 2^shift rounding to nearest, the same way either side of zero. A plain >> rounds towards minus infinity,
+// which left the average of a wheel running backwards a few mm/s short of where it should settle
+static int32_t roundShift(int32_t value, uint8_t shift)
+{
+    int32_t half = 1 << (shift - 1);
+    return value < 0 ? -((-value + half) >> shift) : (value + half) >> shift;
+}
+
+#if ODOM_COMPASS_FUSION
+// Pulls the heading a little way towards the compass. The compass heading goes clockwise, ours counter clockwise
+static void fuseCompass()
+{
+    if(!uBit.compass.isCalibrated())
+        return;
+
+    uint32_t compassHeading = (uint32_t)(-((int64_t)uBit.compass.heading() << 32) / 360);
+    if(!compassReferenced)
+    {
+        compassOffset = compassHeading - odom.heading;
+        compassReferenced = true;
+        return;
+    }
+    int32_t error = (int32_t)(compassHeading - compassOffset - odom.heading);
+    odom.heading += (uint32_t)(error >> ODOM_COMPASS_SHIFT);
+    odom.flags |= ODOM_FLAG_COMPASS;
+}
+#endif
+
+void odometryReset()
+{
+    memset(&odom, 0, sizeof(odom));
+    odom.lastUpdate = uBit.systemTime();
+    compassCount = 0;
+    compassReferenced = false;
+    compassOffset = 0;
+}
+
+// Integrates one encoder sample using the heading halfway through the sample, which is exact for arcs
+void odometryUpdate(int32_t leftTicks, int32_t rightTicks)
+{
+    uint32_t now = uBit.systemTime();
+    uint32_t dt = now - odom.lastUpdate;
+    odom.lastUpdate = now;
+
+    int32_t left = ((int64_t)leftTicks * ODOM_UM_PER_TICK_Q8) >> 8;
+    int32_t right = ((int64_t)rightTicks * ODOM_UM_PER_TICK_Q8) >> 8;
+    int32_t centre = (left + right) / 2;
+    int64_t turn = ((int64_t)(right - left) * ODOM_BAM_PER_RAD) / ODOM_TRACK_UM; // wraps correctly when truncated to 32 bits
+
+    uint32_t midHeading = odom.heading + (uint32_t)(turn / 2);
+    odom.x += (((int64_t)centre * cosQ15(midHeading)) + (1 << 14)) >> 15; // rounded, truncating loses a um every sample
+    odom.y += (((int64_t)centre * sinQ15(midHeading)) + (1 << 14)) >> 15;
+    odom.heading += (uint32_t)turn;
+
+    // um per ms is mm per second. Drop the velocity after a long gap rather than averaging across it
+    if(dt > 0 && dt < 1000)
+    {
+        odom.leftVelocity += roundShift((int32_t)(left / (int32_t)dt) - odom.leftVelocity, ODOM_VELOCITY_SHIFT);
+        odom.rightVelocity += roundShift((int32_t)(right / (int32_t)dt) - odom.rightVelocity, ODOM_VELOCITY_SHIFT);
+    }
+    else
+    {
+        odom.leftVelocity = 0;
+        odom.rightVelocity = 0;
+    }
+
+    if(leftTicks != 0 || rightTicks != 0)
+        odom.flags |= ODOM_FLAG_MOVING;
+    else
+        odom.flags &= ~ODOM_FLAG_MOVING;
+
+#if ODOM_COMPASS_FUSION
+    compassCount++;
+    if(compassCount >= ODOM_COMPASS_PERIOD)
+    {
+        compassCount = 0;
+        fuseCompass();
+    }
+#endif
+}
+
+const OdometryState* odometryGet()
+{
+    return &odom;
+}
+
+uint16_t odometryHeadingCentidegrees()
+{
+    return (uint16_t)(((uint64_t)odom.heading * 36000) >> 32);
+}
+
+// [FINCH_REPORT_ODOMETRY, x mm (4 bytes), y mm (4 bytes), heading 0.01 deg (2 bytes), left mm/s (2 bytes), right mm/s (2 bytes),
+//  time of the sample ms (2 bytes), flags], all MSB first
+void assembleOdometryReport(uint8_t (&report)[FINCH_EXT_REPORT_LENGTH])
+{
+    int32_t x = odom.x / 1000;
+    int32_t y = odom.y / 1000;
+    uint16_t heading = odometryHeadingCentidegrees();
+
+    report[0] = FINCH_REPORT_ODOMETRY;
+    report[1] = (x >> 24) & 0xFF;
+    report[2] = (x >> 16) & 0xFF;
+    report[3] = (x >> 8) & 0xFF;
+    report[4] = x & 0xFF;
+    report[5] = (y >> 24) & 0xFF;
+    report[6] = (y >> 16) & 0xFF;
+    report[7] = (y >> 8) & 0xFF;
+    report[8] = y & 0xFF;
+    report[9] = heading >> 8;
+    report[10] = heading & 0xFF;
+    report[11] = (odom.leftVelocity >> 8) & 0xFF;
+    report[12] = odom.leftVelocity & 0xFF;
+    report[13] = (odom.rightVelocity >> 8) & 0xFF;
+    report[14] = odom.rightVelocity & 0xFF;
+    report[15] = (odom.lastUpdate >> 8) & 0xFF;
+    report[16] = odom.lastUpdate & 0xFF;
+    report[17] = odom.flags;
+}
@@ -0,0 +1,44 @@
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include "BirdBrain.h"
+
+// Finch drivetrain geometry
+#define ODOM_UM_PER_TICK_Q8                       51509 // 201.2 um per encoder tick (49.7 ticks/cm), times 256
+#define ODOM_TRACK_UM                             101000 // distance between the wheel centres in um
+
+// Heading is kept as a binary angle, a full turn is 2^32, so it wraps around for free
+#define ODOM_BAM_PER_RAD                          683565276LL // 2^32 / (2*pi)
+#define ODOM_BAM_QUARTER                          0x40000000UL
+
+#define ODOM_VELOCITY_SHIFT                       2 // velocity smoothing, each sample moves the average 1/4 of the way
+
+// Set to 1 to pull the odometry heading slowly towards the compass, only once the compass has been calibrated
+#define ODOM_COMPASS_FUSION                       0
+#define ODOM_COMPASS_PERIOD                       10 // fuse the compass every this many samples
+#define ODOM_COMPASS_SHIFT                        5  // each fusion moves the heading 1/32 of the way to the compass
+
+// Extended Finch report carrying the odometry, sent to apps that asked for V3 reports
+#define FINCH_REPORT_ODOMETRY                     0x01
+#define FINCH_EXT_REPORT_LENGTH                   18
+
+#define ODOM_FLAG_COMPASS                         0x01 // heading has been corrected by the compass
+#define ODOM_FLAG_MOVING                          0x02 // at least one wheel moved in the last sample
+
+typedef struct {
+    int32_t x;                                    // um, forward from where we were at the last reset
+    int32_t y;                                    // um, to the left
+    uint32_t heading;                             // binary angle, counter clockwise from where we were at the last reset
+    int16_t leftVelocity;                         // mm/s, smoothed
+    int16_t rightVelocity;
+    uint32_t lastUpdate;                          // system time of the last sample
+    uint8_t flags;
+} OdometryState;
+
+void odometryReset(); // Puts us back at the origin, facing along x
+void odometryUpdate(int32_t leftTicks, int32_t rightTicks); // Integrates one encoder sample, ticks since the last sample
+const OdometryState* odometryGet();
+uint16_t odometryHeadingCentidegrees(); // Heading in 0.01 degrees, 0 to 35999
+void assembleOdometryReport(uint8_t (&report)[FINCH_EXT_REPORT_LENGTH]); // Packs the odometry into an extended report
+
+#endif
@@ -0,0 +1,138 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "PinEvents.h"
+
+typedef struct {
+    PinEdge ring[PIN_EVENT_RING];
+    uint8_t next;                                 // where the next edge goes
+    uint8_t edges;                                // edges in the ring, up to PIN_EVENT_RING
+    uint32_t rises;
+    uint32_t lastRise;                            // us
+    uint32_t lastEdge;                            // us
+    uint32_t highTime;                            // us, from the last rise to the fall after it
+    bool risen;                                   // true once we have seen a rise, so the high time means something
+    uint8_t level;
+    bool active;
+} PinEventState;
+
+static PinEventState pins[PIN_EVENT_PINS];
+static bool listening[PIN_EVENT_PINS];
+static const uint16_t pinIds[PIN_EVENT_PINS] = {MICROBIT_ID_IO_P0, MICROBIT_ID_IO_P1, MICROBIT_ID_IO_P2};
+
+// Called straight from the pin interrupt (MESSAGE_BUS_LISTENER_IMMEDIATE), so it only does the bookkeeping.
+// The event was timestamped when the interrupt raised it
+static void onPinEdge(MicroBitEvent evt)
+{
+    int pin = 0;
+    while(pin < PIN_EVENT_PINS && pinIds[pin] != evt.source)
+        pin++;
+    if(pin >= PIN_EVENT_PINS || !pins[pin].active)
+        return;
+    if(evt.value != MICROBIT_PIN_EVT_RISE && evt.value != MICROBIT_PIN_EVT_FALL)
+        return;
+
+    PinEventState *state = &pins[pin];
+    uint32_t time = (uint32_t)evt.timestamp;
+    bool rising = (evt.value == MICROBIT_PIN_EVT_RISE);
+
+    state->ring[state->next].time = time;
+    state->ring[state->next].rising = rising;
+    state->next = (state->next + 1) % PIN_EVENT_RING;
+    if(state->edges < PIN_EVENT_RING)
+        state->edges++;
+
+    if(rising)
+    {
+        state->rises++;
+        state->lastRise = time;
+        state->risen = true;
+        state->level = 1;
+    }
+    else
+    {
+        if(state->risen)
+            state->highTime = time - state->lastRise;
+        state->level = 0;
+    }
+    state->lastEdge = time;
+}
+
+void pinEventsEnable(uint8_t pin)
+{
+    if(pin >= PIN_EVENT_PINS || pins[pin].active)
+        return; // the apps resend the pin modes with every command
+
+    if(!listening[pin])
+    {
+        uBit.messageBus.listen(pinIds[pin], MICROBIT_EVT_ANY, onPinEdge, MESSAGE_BUS_LISTENER_IMMEDIATE);
+        listening[pin] = true;
+    }
+
+    memset(&pins[pin], 0, sizeof(PinEventState));
+    pins[pin].level = uBit.io.pin[pin].getDigitalValue();
+    pins[pin].lastEdge = (uint32_t)system_timer_current_time_us();
+    pins[pin].active = true;
+    uBit.io.pin[pin].eventOn(MICROBIT_PIN_EVENT_ON_EDGE);
+}
+
+void pinEventsDisable(uint8_t pin)
+{
+    if(pin >= PIN_EVENT_PINS || !pins[pin].active)
+        return;
+
+    pins[pin].active = false;
+    uBit.io.pin[pin].eventOn(MICROBIT_PIN_EVENT_NONE);
+}
+
+bool pinEventsActive(uint8_t pin)
+{
+    return pin < PIN_EVENT_PINS && pins[pin].active;
+}
+
+void assemblePinReport(uint8_t pin, uint8_t (&report)[PIN_REPORT_LENGTH])
+{
+    // Take a copy with the pin interrupt held off, so the numbers all come from the same edge
+    PinEventState state;
+    target_disable_irq();
+    state = pins[pin];
+    target_enable_irq();
+
+    // Average the period over the rising edges still in the ring, newest first
+    uint32_t newestRise = 0;
+    uint32_t oldestRise = 0;
+    uint8_t risesUsed = 0;
+    for(int i = 1; i <= state.edges; i++)
+    {
+        PinEdge *edge = &state.ring[(state.next + PIN_EVENT_RING - i) % PIN_EVENT_RING];
+        if(!edge->rising)
+            continue;
+        if(risesUsed == 0)
+            newestRise = edge->time;
+        oldestRise = edge->time;
+        risesUsed++;
+    }
+    uint32_t period = (risesUsed > 1) ? (newestRise - oldestRise) / (risesUsed - 1) : 0;
+
+    uint32_t sinceEdge = ((uint32_t)system_timer_current_time_us() - state.lastEdge) / 1000;
+    if(sinceEdge > 0xFFFF)
+        sinceEdge = 0xFFFF;
+
+    report[0] = PIN_REPORT_EVENTS;
+    report[1] = pin;
+    report[2] = state.level;
+    report[3] = (state.rises >> 24) & 0xFF;
+    report[4] = (state.rises >> 16) & 0xFF;
+    report[5] = (state.rises >> 8) & 0xFF;
+    report[6] = state.rises & 0xFF;
+    report[7] = (period >> 24) & 0xFF;
+    report[8] = (period >> 16) & 0xFF;
+    report[9] = (period >> 8) & 0xFF;
+    report[10] = period & 0xFF;
+    report[11] = (state.highTime >> 24) & 0xFF;
+    report[12] = (state.highTime >> 16) & 0xFF;
+    report[13] = (state.highTime >> 8) & 0xFF;
+    report[14] = state.highTime & 0xFF;
+    report[15] = sinceEdge >> 8;
+    report[16] = sinceEdge & 0xFF;
+    report[17] = (risesUsed > 1) ? risesUsed - 1 : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef PINEVENTS_H
+#define PINEVENTS_H
+
+#include "BirdBrain.h"
+
+// Edge event mode for pins 0, 1 and 2, picked with mode 3 in the pin's field of the MICRO_IO command.
+// Every edge is counted and timestamped from the pin interrupt, so the app gets counts, frequency and pulse widths
+// without polling the pin itself
+#define PIN_EVENT_PINS                            3
+#define PIN_EVENT_RING                            8 // edges kept, the period is averaged over the rising edges among them
+
+// Extended report sent to V3 links for each pin in event mode: [PIN_REPORT_EVENTS, pin, level, rising edges (4 bytes),
+//  period us (4 bytes), high time us (4 bytes), ms since the last edge (2 bytes), periods averaged], MSB first
+#define PIN_REPORT_EVENTS                         0x03 // after the Finch's FINCH_REPORT_ODOMETRY and FINCH_REPORT_ENCODERS
+#define PIN_REPORT_LENGTH                         18
+
+typedef struct {
+    uint32_t time;                                // us, from the event
+    bool rising;
+} PinEdge;
+
+void pinEventsEnable(uint8_t pin); // Arms edge events on a pin, starting the counts from zero
+void pinEventsDisable(uint8_t pin); // Before the pin is used for anything else
+bool pinEventsActive(uint8_t pin);
+void assemblePinReport(uint8_t pin, uint8_t (&report)[PIN_REPORT_LENGTH]);
+
+#endif
@@ -0,0 +1,141 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "Hummingbird.h"
+#include "ServoMotion.h"
+
+static ServoTrack servos[SERVO_PORTS];
+static uint8_t lastFrame[LENGTH_SETALL_SPI] = {SETALL_SPI, 0, 0, 0, 0, 0, 0, 0, 0, SERVO_OFF, SERVO_OFF, SERVO_OFF, SERVO_OFF}; // last frame we built, the base for the next one
+static uint8_t servosMoving = 0;
+
+// Eased progress for t from 0 to 65536, also 0 to 65536
+static uint32_t ease(uint8_t easing, uint32_t t)
+{
+    uint64_t square = ((uint64_t)t * t) >> 16;
+    switch(easing)
+    {
+        case SERVO_EASE_IN:
+            return square;
+        case SERVO_EASE_OUT:
+            return 65536 - (((uint64_t)(65536 - t) * (65536 - t)) >> 16);
+        case SERVO_EASE_IN_OUT:
+            return (square * (3*65536 - 2*t)) >> 16; // smoothstep, 3t^2 - 2t^3
+        default:
+            return t;
+    }
+}
+
+// Where a servo should be now, and stops the move once it gets there
+static uint8_t servoPosition(ServoTrack *servo, uint32_t now)
+{
+    uint32_t elapsed = now - servo->startTime;
+    if(elapsed >= servo->duration)
+    {
+        servo->moving = false;
+        servosMoving--;
+        return servo->target;
+    }
+
+    uint32_t t = (uint32_t)(((uint64_t)elapsed << 16) / servo->duration);
+    int32_t span = (int32_t)servo->target - servo->start;
+    return servo->start + (int32_t)(((int64_t)span * ease(servo->easing, t) + 32768) >> 16);
+}
+
+void servoMotionCommand(uint8_t commands[], uint8_t length)
+{
+    if(length < SERVO_MOTION_LENGTH || commands[1] < 1 || commands[1] > SERVO_PORTS)
+        return;
+
+    uint8_t port = commands[1] - 1;
+    uint8_t target = commands[2];
+    uint8_t profile = commands[3];
+    uint16_t value = (commands[4] << 8) | commands[5];
+    ServoTrack *servo = &servos[port];
+    uint8_t current = lastFrame[SERVO_FRAME_OFFSET + port];
+
+    if(servo->moving)
+    {
+        servo->moving = false;
+        servosMoving--;
+    }
+    servo->held = true;
+
+    // Nothing to ease from or to if the servo is off, and a speed of 0 would never get there
+    uint32_t duration = value;
+    if(profile & SERVO_PROFILE_VELOCITY)
+    {
+        uint8_t distance = (target > current) ? target - current : current - target;
+        duration = value ? ((uint32_t)distance * 1000 + value - 1) / value : 0;
+    }
+    if(current == SERVO_OFF || target == SERVO_OFF || duration == 0 || target == current)
+    {
+        lastFrame[SERVO_FRAME_OFFSET + port] = target;
+        writeHBOutputs(lastFrame);
+        return;
+    }
+
+    servo->start = current;
+    servo->target = target;
+    servo->easing = profile & SERVO_EASE_MASK;
+    servo->startTime = uBit.systemTime();
+    servo->duration = duration;
+    servo->moving = true;
+    servosMoving++;
+}
+
+// A servo we set keeps our position while the app's setAll repeats its old value for it, changing the value takes the servo back
+void servoMotionApply(uint8_t (&frame)[LENGTH_SETALL_SPI])
+{
+    uint32_t now = uBit.systemTime();
+
+    for(int i = 0; i < SERVO_PORTS; i++)
+    {
+        ServoTrack *servo = &servos[i];
+        uint8_t appValue = frame[SERVO_FRAME_OFFSET + i];
+
+        if(servo->held && appValue == servo->appValue)
+        {
+            frame[SERVO_FRAME_OFFSET + i] = servo->moving ? servoPosition(servo, now) : lastFrame[SERVO_FRAME_OFFSET + i];
+        }
+        else
+        {
+            if(servo->moving)
+                servosMoving--;
+            servo->moving = false;
+            servo->held = false;
+        }
+        servo->appValue = appValue;
+    }
+    memcpy(lastFrame, frame, LENGTH_SETALL_SPI);
+}
+
+void servoMotionCancel()
+{
+    // The stop command turns the LEDs and servos off
+    memset(lastFrame, 0, LENGTH_SETALL_SPI);
+    lastFrame[0] = SETALL_SPI;
+    for(int i = 0; i < SERVO_PORTS; i++)
+    {
+        servos[i].moving = false;
+        servos[i].held = false;
+        lastFrame[SERVO_FRAME_OFFSET + i] = SERVO_OFF;
+    }
+    servosMoving = 0;
+}
+
+void servoMotionLoop()
+{
+    while(1)
+    {
+        if(whatAmI == A_HB && servosMoving > 0)
+        {
+            uint32_t now = uBit.systemTime();
+            for(int i = 0; i < SERVO_PORTS; i++)
+            {
+                if(servos[i].moving)
+                    lastFrame[SERVO_FRAME_OFFSET + i] = servoPosition(&servos[i], now);
+            }
+            writeHBOutputs(lastFrame); // the cache drops the frame if no servo moved a whole step
+        }
+        fiber_sleep(SERVO_FRAME_PERIOD);
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef SERVOMOTION_H
+#define SERVOMOTION_H
+
+#include "BirdBrain.h"
+
+// HB_SERVO_MOTION command: [HB_SERVO_MOTION, port (1-4), target, profile, value (2 bytes, MSB first)]
+// The profile's top bit says what the value is, the low bits pick the easing curve
+#define SERVO_MOTION_LENGTH                       6
+#define SERVO_PROFILE_VELOCITY                    0x80 // value is the top speed in servo units per second, otherwise a duration in ms
+#define SERVO_EASE_MASK                           0x03
+#define SERVO_EASE_LINEAR                         0x00
+#define SERVO_EASE_IN                             0x01
+#define SERVO_EASE_OUT                            0x02
+#define SERVO_EASE_IN_OUT                         0x03
+
+// Servos live in bytes 9 to 12 of the SETALL_SPI frame, 255 turns a servo off
+#define SERVO_PORTS                               4
+#define SERVO_FRAME_OFFSET                        9
+#define SERVO_OFF                                 255
+
+#define SERVO_FRAME_PERIOD                        20 // ms between frames while a servo is moving, 50 Hz like the servo pulses themselves
+
+typedef struct {
+    bool moving;
+    bool held;                                    // we set this servo, true until the app changes its own value for it
+    uint8_t start;                                // position when the move began
+    uint8_t target;
+    uint8_t easing;
+    uint32_t startTime;
+    uint32_t duration;                            // ms
+    uint8_t appValue;                             // what the app last put in its own setAll for this port
+} ServoTrack;
+
+void servoMotionCommand(uint8_t commands[], uint8_t length); // Decodes a HB_SERVO_MOTION command and starts the move
+void servoMotionApply(uint8_t (&frame)[LENGTH_SETALL_SPI]); // Remembers a setAll frame from the app, and puts in the positions of any servos we are moving
+void servoMotionCancel(); // Stops every move where it is, e.g. because the HB was stopped
+void servoMotionLoop(); // Fiber that sends the in-between positions
+
+#endif
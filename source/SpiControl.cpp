@@ -46,7 +46,7 @@ void spiWrite(uint8_t* writeBuffer, uint8_t length)
     }
 }
 
-void spiReadHB(uint8_t (&readBuffer)[V2_SENSOR_SEND_LENGTH])
+bool spiReadHB(uint8_t (&readBuffer)[V2_SENSOR_SEND_LENGTH])
 {
     // Wait up to 5 ms for another SPI command to complete
     uint8_t timeOut = 0;
@@ -68,7 +68,9 @@ void spiReadHB(uint8_t (&readBuffer)[V2_SENSOR_SEND_LENGTH])
 
         uBit.io.P16.setDigitalValue(1);
         spiActive = false;
+        return true;
     }
+    return false;
 }
 
 void spiReadFinch(uint8_t (&readBuffer)[FINCH_SPI_SENSOR_LENGTH])
@@ -98,59 +100,32 @@ void spiReadFinch(uint8_t (&readBuffer)[FINCH_SPI_SENSOR_LENGTH])
     }
 }
 
-ManagedString whichDevice()
+// Sets whatAmI from a SAMD ID and returns the matching name prefix. Anything we don't recognise is a standalone micro:bit
+ManagedString setDeviceType(uint8_t device)
 {
-    ManagedString devicePrefix = "";
-
-    // Reading the firmware version, doing this twice as the first time it seems like values are junk    
-    readFirmwareVersion();
-    uint8_t device = readFirmwareVersion();
-   
-	switch(device)
-	{
-		case MICROBIT_SAMD_ID:
-			devicePrefix="MB";
-            whatAmI = A_MB;
-			break;
-		case FINCH_SAMD_ID:
-			devicePrefix="FN";
+    actuatorCacheInvalidate(); // a different board, or the same one after a reset, has none of our outputs set
+    if(device == FINCH_SAMD_ID || device == HUMMINGBIT_SAMD_ID)
+    {
+        // Pins 0-2 belong to the Finch or Hummingbird now, so stop anything the micro:bit modes left on them
+        for(int i = 0; i < EDGE_INPUTS; i++)
+            edgeInputDisable(i);
+        for(int i = 0; i < PIN_EVENT_PINS; i++)
+            pinEventsDisable(i);
+    }
+    switch(device)
+    {
+        case FINCH_SAMD_ID:
             whatAmI = A_FINCH;
             //initFinch();
-			break;
-		case HUMMINGBIT_SAMD_ID:
-			devicePrefix="BB";
+            return ManagedString("FN");
+        case HUMMINGBIT_SAMD_ID:
             whatAmI = A_HB;
             initHB();
-			break;
-        // If it was none of the above, including not 0, try one more time to get a value
-		default:
-            device = readFirmwareVersion();
-            switch(device)
-            {
-                case MICROBIT_SAMD_ID:
-                    devicePrefix="MB";
-                    whatAmI = A_MB;
-                    break;
-                case FINCH_SAMD_ID:
-                    devicePrefix="FN";
-                    whatAmI = A_FINCH;
-                    //initFinch();
-                    break;
-                case HUMMINGBIT_SAMD_ID:
-                    devicePrefix="BB";
-                    whatAmI = A_HB;
-                    initHB();
-                    break;   
-                // If the value is still junk, call it a standalone micro:bit 
-                default:            
-                    devicePrefix="MB";
-                    whatAmI = A_MB;
-        			break;
-            }
-            break;
-	}
-    
-    return devicePrefix;
+            return ManagedString("BB");
+        default:
+            whatAmI = A_MB;
+            return ManagedString("MB");
+    }
 }
 
 uint8_t readFirmwareVersion()
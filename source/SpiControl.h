@@ -22,9 +22,9 @@
 
 void spiInit();
 void spiWrite(uint8_t* writeBuffer, uint8_t length);
-void spiReadHB(uint8_t (&readBuffer)[V2_SENSOR_SEND_LENGTH]);
+bool spiReadHB(uint8_t (&readBuffer)[V2_SENSOR_SEND_LENGTH]); // false if another fiber held the bus too long
 void spiReadFinch(uint8_t (&readBuffer)[FINCH_SPI_SENSOR_LENGTH]);
-ManagedString whichDevice();
+ManagedString setDeviceType(uint8_t device); // Sets whatAmI from a SAMD ID and returns our name prefix
 uint8_t readFirmwareVersion();
 
 // Function for debugging use only
@@ -0,0 +1,172 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "TextDisplay.h"
+
+static uint8_t glyphs[TEXT_MAX_LENGTH][BITMAP_FONT_WIDTH]; // each character as 5 columns, bit n of a column is row n
+static uint8_t textLength = 0;
+static uint8_t textMode = TEXT_FLASH;
+static uint8_t scrollSpeed = TEXT_SCROLL_DEFAULT;
+static uint16_t textStep = 0; // character (flashing) or column (scrolling) we are up to
+static bool charShowing = false; // flashing, true while the character is up rather than the gap after it
+static bool listening = false;
+static uint32_t nextDue = 0; // when the current step ends
+
+// Turns a character's font rows into 5 columns, bit n of a column is row n
+static void glyphColumns(uint8_t c, uint8_t (&columns)[BITMAP_FONT_WIDTH])
+{
+    if(c < BITMAP_FONT_ASCII_START || c > BITMAP_FONT_ASCII_END)
+        c = ' ';
+    const uint8_t *rows = BitmapFont::defaultFont + BITMAP_FONT_WIDTH * (c - BITMAP_FONT_ASCII_START);
+
+    for(int x = 0; x < BITMAP_FONT_WIDTH; x++)
+    {
+        uint8_t column = 0;
+        for(int y = 0; y < BITMAP_FONT_HEIGHT; y++)
+        {
+            if(rows[y] & (1 << (BITMAP_FONT_WIDTH - 1 - x)))
+                column |= 1 << y;
+        }
+        columns[x] = column;
+    }
+}
+
+// Converts the whole message once, so scrolling only has to copy bits
+static void cacheGlyphs(const uint8_t *text, uint8_t length)
+{
+    for(int i = 0; i < length; i++)
+        glyphColumns(text[i], glyphs[i]);
+}
+
+// Draws 5 columns straight into the display's back buffer, shown whole from the next display frame
+static void drawColumns(const uint8_t (&columns)[BITMAP_FONT_WIDTH])
+{
+    uint8_t *pixels = uBit.display.beginFrame();
+    for(int x = 0; x < BITMAP_FONT_WIDTH; x++)
+    {
+        for(int y = 0; y < BITMAP_FONT_HEIGHT; y++)
+            pixels[y*BITMAP_FONT_WIDTH + x] = (columns[x] & (1 << y)) ? 255 : 0;
+    }
+    uBit.display.endFrame();
+}
+
+// Column of the whole message laid out in a strip, blank between characters and off either end
+static uint8_t stripColumn(int32_t column)
+{
+    if(column < 0 || column >= textLength * TEXT_CHAR_COLUMNS)
+        return 0;
+    uint8_t x = column % TEXT_CHAR_COLUMNS;
+    return (x < BITMAP_FONT_WIDTH) ? glyphs[column / TEXT_CHAR_COLUMNS][x] : 0;
+}
+
+// Draws the strip starting at this column
+static void drawStrip(int32_t firstColumn)
+{
+    uint8_t columns[BITMAP_FONT_WIDTH];
+    for(int x = 0; x < BITMAP_FONT_WIDTH; x++)
+        columns[x] = stripColumn(firstColumn + x);
+    drawColumns(columns);
+}
+
+static void schedule(uint32_t delay)
+{
+    nextDue += delay;
+    uint32_t now = uBit.systemTime();
+    if((int32_t)(nextDue - now) <= 0)
+        nextDue = now + delay; // we fell behind, carry on from now
+    system_timer_event_after(nextDue - now, BB_ID, FLASH_MSG_EVT);
+}
+
+// Shows the current step and schedules the next one, returns false once the message is over
+static bool render()
+{
+    if(textMode == TEXT_SCROLL)
+    {
+        // Start with the message just off the right hand side, finish once it has gone off the left
+        if(textStep > textLength * TEXT_CHAR_COLUMNS + BITMAP_FONT_WIDTH)
+            return false;
+        drawStrip((int32_t)textStep - BITMAP_FONT_WIDTH);
+        schedule(scrollSpeed);
+    }
+    else
+    {
+        if(textStep >= textLength)
+            return false;
+        if(charShowing)
+        {
+            drawStrip(textStep * TEXT_CHAR_COLUMNS);
+            schedule(TEXT_FLASH_ON);
+        }
+        else
+        {
+            uBit.display.clear(); // clear the display to provide a "flash"
+            schedule(TEXT_FLASH_OFF);
+        }
+    }
+    return true;
+}
+
+// Timer event for the end of a step. Events left over from a message that was replaced arrive early and are ignored
+static void textTick(MicroBitEvent)
+{
+    if(!flashOn || (int32_t)(uBit.systemTime() - nextDue) < 0)
+        return;
+
+    if(textMode == TEXT_SCROLL)
+    {
+        textStep++;
+    }
+    else
+    {
+        if(!charShowing)
+            textStep++;
+        charShowing = !charShowing;
+    }
+
+    if(!render())
+        flashOn = false; // No longer showing the message
+}
+
+void textDisplaySetMode(uint8_t commands[], uint8_t length)
+{
+    if(length < TEXT_MODE_LENGTH)
+        return;
+    textMode = (commands[1] == TEXT_SCROLL) ? TEXT_SCROLL : TEXT_FLASH;
+    scrollSpeed = (commands[2] < TEXT_SCROLL_MIN) ? TEXT_SCROLL_MIN : commands[2];
+}
+
+void textDisplayShow(const uint8_t *text, uint8_t length)
+{
+    if(!listening)
+    {
+        uBit.messageBus.listen(BB_ID, FLASH_MSG_EVT, textTick);
+        listening = true;
+    }
+
+    if(length > TEXT_MAX_LENGTH)
+        length = TEXT_MAX_LENGTH;
+    textLength = length;
+    if(length == 0)
+    {
+        flashOn = false;
+        return;
+    }
+
+    cacheGlyphs(text, length);
+    textStep = (textMode == TEXT_SCROLL) ? 1 : 0; // a scroll starts with the first column already showing
+    charShowing = true;
+    flashOn = true;
+    nextDue = uBit.systemTime();
+    render();
+}
+
+void textDisplayChar(uint8_t c)
+{
+    uint8_t columns[BITMAP_FONT_WIDTH];
+    glyphColumns(c, columns);
+    drawColumns(columns);
+}
+
+bool textDisplayRunning()
+{
+    return flashOn;
+}
@@ -0,0 +1,23 @@
+#ifndef TEXTDISPLAY_H
+#define TEXTDISPLAY_H
+
+#include "BirdBrain.h"
+
+// MB_TEXT_MODE command: [MB_TEXT_MODE, mode, scroll speed in ms per column], applies to the messages that follow
+#define TEXT_MODE_LENGTH                          3
+#define TEXT_FLASH                                0x00 // one character at a time, the way the apps have always shown messages
+#define TEXT_SCROLL                               0x01 // scrolls the message smoothly from right to left
+
+#define TEXT_MAX_LENGTH                           18 // longest message a SCROLL command can carry
+#define TEXT_FLASH_ON                             400 // ms each character is shown for when flashing
+#define TEXT_FLASH_OFF                            200 // ms the screen is blank between characters
+#define TEXT_SCROLL_DEFAULT                       80 // ms per column
+#define TEXT_SCROLL_MIN                           20
+#define TEXT_CHAR_COLUMNS                         6 // 5 columns of glyph and a blank one, when scrolling
+
+void textDisplaySetMode(uint8_t commands[], uint8_t length); // Decodes a MB_TEXT_MODE command
+void textDisplayShow(const uint8_t *text, uint8_t length); // Starts a message straight away, replacing any message already showing
+void textDisplayChar(uint8_t c); // Shows one character, without touching any message that is running
+bool textDisplayRunning();
+
+#endif
@@ -0,0 +1,274 @@
+#include "MicroBit.h"
+#include "BirdBrain.h"
+#include "ToneSequencer.h"
+
+typedef struct {
+    ToneNote queue[TONE_QUEUE_LENGTH];
+    uint8_t head;                                 // note playing
+    uint8_t count;                                // notes in the queue, including the one playing
+    uint16_t link;                                // app that sent the melody, gets the notifications
+    bool reportDone;                              // only melodies the app sent are reported, not single notes or our own sounds
+    bool playing;
+    uint32_t nextDue;                             // when the note playing is over
+} ToneVoice;
+
+static ToneVoice voices[TONE_VOICES];
+static SoundOutputPin *speakerVoices[TONE_VOICES]; // mixer channels feeding the speaker, made the first time each voice plays
+static bool listening = false;
+static const uint16_t voiceEvents[TONE_VOICES] = {MB_BUZZ_EVT, MB_BUZZ1_EVT, MB_BUZZ2_EVT}; // each voice has its own timer event
+
+// Names of the built in sound expressions, in the order SOUND_EXPRESSION numbers them
+static const char * const expressions[] = {"giggle", "happy", "hello", "mysterious", "sad", "slide", "soaring", "spring", "twinkle", "yawn"};
+#define SOUND_EXPRESSIONS (sizeof(expressions) / sizeof(expressions[0]))
+
+static void notify(uint8_t voice, uint8_t event)
+{
+    if(!bleuart->getConnected(voices[voice].link))
+        return;
+    uint8_t report[MELODY_REPORT_LENGTH];
+    report[0] = MB_MELODY;
+    report[1] = event;
+    report[2] = voice;
+    report[3] = voices[voice].count;
+    bleLinkSend(voices[voice].link, report, MELODY_REPORT_LENGTH);
+}
+
+// Voice 0 uses the audio pipeline's own square wave channel, the others get one of their own
+static SoundOutputPin *speakerVoice(uint8_t voice)
+{
+    if(speakerVoices[voice] == NULL)
+        speakerVoices[voice] = (voice == 0) ? &uBit.audio.virtualOutputPin : new SoundOutputPin(uBit.audio.mixer);
+    return speakerVoices[voice];
+}
+
+// The speaker's mixer on a micro:bit, the Finch/HB buzzer on pin 0 otherwise
+static void toneOn(uint8_t voice, uint16_t period)
+{
+    if(whatAmI == A_MB)
+    {
+        SoundOutputPin *pin = speakerVoice(voice);
+        pin->setAnalogValue(512);
+        pin->setAnalogPeriodUs(period);
+    }
+    else if(voice == 0)
+    {
+        uBit.io.P0.setAnalogValue(512);
+        uBit.io.P0.setAnalogPeriodUs(period);
+    }
+}
+
+// Silences the mixer channel whatever we are now, in case we were a micro:bit when the note started
+static void toneOff(uint8_t voice)
+{
+    if(speakerVoices[voice] != NULL)
+        speakerVoices[voice]->setAnalogValue(0);
+    if(whatAmI != A_MB && voice == 0)
+        uBit.io.P0.setAnalogValue(0);
+}
+
+static void stopVoice(uint8_t voice)
+{
+    system_timer_cancel_event(BB_ID, voiceEvents[voice]);
+    voices[voice].playing = false;
+    voices[voice].head = 0;
+    voices[voice].count = 0;
+    toneOff(voice);
+}
+
+// Starts the note at the head of the queue and asks the system timer for an event when it is over
+static void startNote(uint8_t voice, uint32_t start)
+{
+    ToneVoice *v = &voices[voice];
+    ToneNote *note = &v->queue[v->head];
+    if(note->period > TONE_MIN_PERIOD)
+        toneOn(voice, note->period);
+    else
+        toneOff(voice);
+    v->nextDue = start + note->duration;
+    // Drop the event for the note this one replaces, or it fires early and is wasted
+    system_timer_cancel_event(BB_ID, voiceEvents[voice]);
+    system_timer_event_after(v->nextDue - uBit.systemTime(), BB_ID, voiceEvents[voice]);
+}
+
+// Moves a voice on to its next note if the one playing is over
+static void advance(uint8_t voice, uint32_t now)
+{
+    ToneVoice *v = &voices[voice];
+    if(!v->playing || (int32_t)(now - v->nextDue) < 0)
+        return;
+
+    v->head = (v->head + 1) % TONE_QUEUE_LENGTH;
+    v->count--;
+    if(v->count == 0)
+    {
+        stopVoice(voice);
+        if(v->reportDone)
+            notify(voice, MELODY_DONE);
+        return;
+    }
+
+    // Each note starts when the last was due to end, so a melody keeps its tempo.
+    // If we fell a whole note behind, start counting again from now
+    uint32_t start = v->nextDue;
+    if((int32_t)(start + v->queue[v->head].duration - now) <= 0)
+        start = now;
+    startNote(voice, start);
+}
+
+// Timer event for the end of a note on one voice. advance() still checks the note is over, in case the timer fires early
+static void toneTick(MicroBitEvent evt)
+{
+    for(int voice = 0; voice < TONE_VOICES; voice++)
+    {
+        if(voiceEvents[voice] == evt.value)
+            advance(voice, uBit.systemTime());
+    }
+}
+
+// Returns false if the queue was full
+static bool addNote(ToneVoice *v, uint16_t period, uint16_t duration)
+{
+    if(v->count >= TONE_QUEUE_LENGTH)
+        return false;
+
+    ToneNote *note = &v->queue[(v->head + v->count) % TONE_QUEUE_LENGTH];
+    note->period = period;
+    note->duration = (duration < TONE_MIN_DURATION) ? TONE_MIN_DURATION : duration;
+    v->count++;
+    return true;
+}
+
+static void playNotes(uint8_t voice, const ToneNote *notes, uint8_t noteCount, bool append)
+{
+    ToneVoice *v = &voices[voice];
+    if(!append)
+    {
+        v->playing = false;
+        v->head = 0;
+        v->count = 0;
+    }
+
+    bool dropped = false;
+    for(int i = 0; i < noteCount; i++)
+    {
+        if(!addNote(v, notes[i].period, notes[i].duration))
+            dropped = true;
+    }
+    if(dropped && v->reportDone)
+        notify(voice, MELODY_FULL);
+
+    if(!v->playing && v->count > 0)
+    {
+        v->playing = true;
+        startNote(voice, uBit.systemTime());
+    }
+}
+
+void toneSequencerInit()
+{
+    if(!listening)
+    {
+        for(int voice = 0; voice < TONE_VOICES; voice++)
+            uBit.messageBus.listen(BB_ID, voiceEvents[voice], toneTick);
+        listening = true;
+    }
+    // Pin 0 is ours, so keep the speaker's audio off it
+    uBit.audio.setPinEnabled(false);
+    for(int voice = 0; voice < TONE_VOICES; voice++)
+    {
+        voices[voice].playing = false;
+        voices[voice].head = 0;
+        voices[voice].count = 0;
+        voices[voice].link = BLE_CONN_HANDLE_INVALID;
+    }
+}
+
+void toneSequencerPlay(uint16_t period, uint16_t duration)
+{
+    ToneNote note = {period, duration};
+    toneSequencerPlayNotes(&note, 1, false);
+}
+
+void toneSequencerPlayNotes(const ToneNote *notes, uint8_t noteCount, bool append)
+{
+    voices[0].reportDone = false;
+    playNotes(0, notes, noteCount, append);
+}
+
+uint8_t toneSequencerCommandLength(uint8_t flags)
+{
+    uint8_t notes = flags & MELODY_COUNT_MASK;
+    if(notes > MELODY_MAX_NOTES)
+        return 0; // can't be one of ours, and we can't tell where it ends
+    return MELODY_HEADER_LENGTH + notes * MELODY_NOTE_BYTES;
+}
+
+void toneSequencerCommand(uint8_t commands[], uint8_t length, uint16_t link)
+{
+    if(length < MELODY_HEADER_LENGTH || toneSequencerCommandLength(commands[1]) == 0 || length < toneSequencerCommandLength(commands[1]))
+        return;
+
+    uint8_t voice = (commands[1] & MELODY_VOICE_MASK) >> MELODY_VOICE_SHIFT;
+    if(voice >= TONE_VOICES)
+        return;
+
+    uint8_t noteCount = (toneSequencerCommandLength(commands[1]) - MELODY_HEADER_LENGTH) / MELODY_NOTE_BYTES;
+    if(noteCount == 0)
+    {
+        stopVoice(voice);
+        return;
+    }
+
+    ToneNote notes[MELODY_MAX_NOTES];
+    for(int i = 0; i < noteCount; i++)
+    {
+        uint8_t *note = &commands[MELODY_HEADER_LENGTH + i*MELODY_NOTE_BYTES];
+        notes[i].period = (note[0] << 8) | note[1];
+        notes[i].duration = (note[2] << 8) | note[3];
+    }
+    voices[voice].link = link;
+    voices[voice].reportDone = true;
+    playNotes(voice, notes, noteCount, commands[1] & MELODY_APPEND);
+}
+
+void toneSequencerSoundCommand(uint8_t commands[], uint8_t length)
+{
+    if(length < SOUND_LENGTH)
+        return;
+
+    switch(commands[1])
+    {
+        case SOUND_VOLUME:
+            uBit.audio.setVolume(commands[2]);
+            break;
+        case SOUND_EXPRESSION:
+            if(commands[2] < SOUND_EXPRESSIONS)
+            {
+                MicroBitAudio::requestActivation(); // the expression's mixer channel is added when the audio starts up
+                uBit.audio.soundExpressions.playAsync(ManagedString(expressions[commands[2]]));
+            }
+            break;
+        case SOUND_STOP:
+            toneSequencerStop();
+            break;
+        default:
+            break;
+    }
+}
+
+void toneSequencerStop()
+{
+    uBit.audio.soundExpressions.stop();
+    for(int voice = 0; voice < TONE_VOICES; voice++)
+        stopVoice(voice);
+}
+
+bool toneSequencerPlaying()
+{
+    for(int voice = 0; voice < TONE_VOICES; voice++)
+    {
+        if(voices[voice].playing)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,48 @@
+#ifndef TONESEQUENCER_H
+#define TONESEQUENCER_H
+
+#include "BirdBrain.h"
+
+// MB_MELODY command: [MB_MELODY, flags | voice | number of notes, then each note as period us (2 bytes), duration ms (2 bytes)], MSB first
+// No notes stops the voice. A period of 0 is a rest
+#define MELODY_APPEND                             0x80 // add the notes to the end of the queue rather than starting over
+#define MELODY_VOICE_MASK                         0x30
+#define MELODY_VOICE_SHIFT                        4
+#define MELODY_COUNT_MASK                         0x0F
+#define MELODY_MAX_NOTES                          4 // as many as fit in one command
+#define MELODY_NOTE_BYTES                         4
+#define MELODY_HEADER_LENGTH                      2
+
+// Notifications: [MB_MELODY, event, voice, notes left in the queue]
+#define MELODY_REPORT_LENGTH                      4
+#define MELODY_DONE                               0x01 // the last note finished
+#define MELODY_FULL                               0x02 // notes were dropped, send them again once the queue has room
+
+// MB_SOUND command: [MB_SOUND, operation, value], for the speaker on the micro:bit
+#define SOUND_LENGTH                              3
+#define SOUND_VOLUME                              0x00 // value is the speaker volume, 0-255
+#define SOUND_EXPRESSION                          0x01 // value picks one of the built in sound expressions
+#define SOUND_STOP                                0x02 // stops the sound expression and every voice
+
+// Voices play at the same time. On the micro:bit each is a channel of the speaker's mixer. A Finch or Hummingbird has
+// one buzzer, so only voice 0 is heard there, the others are still timed so the app gets its notifications
+#define TONE_VOICES                               3
+#define TONE_QUEUE_LENGTH                         16 // notes per voice
+#define TONE_MIN_PERIOD                           50 // us, shorter periods are above 20 kHz and play as a rest
+#define TONE_MIN_DURATION                         10 // ms, shorter notes are stretched to this
+
+typedef struct {
+    uint16_t period;                              // us, 0 for a rest
+    uint16_t duration;                            // ms
+} ToneNote;
+
+void toneSequencerInit();
+void toneSequencerPlay(uint16_t period, uint16_t duration); // Plays one note on voice 0 straight away, replacing anything already playing there
+void toneSequencerPlayNotes(const ToneNote *notes, uint8_t count, bool append); // Queues notes on voice 0, starting them straight away unless appending
+uint8_t toneSequencerCommandLength(uint8_t flags); // Bytes an MB_MELODY command takes, from its second byte, 0 if it has more than MELODY_MAX_NOTES notes
+void toneSequencerCommand(uint8_t commands[], uint8_t length, uint16_t link); // Decodes an MB_MELODY command
+void toneSequencerSoundCommand(uint8_t commands[], uint8_t length); // Decodes an MB_SOUND command
+void toneSequencerStop(); // Silences every voice and any sound expression, and forgets the queues
+bool toneSequencerPlaying();
+
+#endif
@@ -21,71 +21,21 @@ void ble_mgmt_loop() {
     }
 }
 
-// Checks if the device type has changed once per second if not connected
+// Checks if the device type has changed if not connected
 // If you plug in the micro:bit to a HB or Finch after powering it on, the advertised name changes
+// DeviceDetect decides how often to probe and debounces noisy reads, we just wake up often enough to let it
 void check_device_loop() {
 
-    uint8_t past_device;
-    uint8_t current_device=0;
-    bool update;
-    ManagedString devicePrefix;
-
-    // initializing current device to whatever it is at start up
-    switch(whatAmI)
-    {
-        case A_MB:
-            current_device = MICROBIT_SAMD_ID;
-            // will need to init MB to make sure the edge connector isn't left in a poor state
-            break;
-        case A_HB:
-            current_device = HUMMINGBIT_SAMD_ID;
-            break;
-        case A_FINCH:
-            current_device = FINCH_SAMD_ID;
-            // will need to init Finch and make sure reset line is low
-            break;
-    }
-
     while(1) {
         // If you're connected to a tablet/computer, we're not changing your prefix in mid-use, so only do the following
         // if you're not connected
-        if(!bleConnected) {
-            past_device = current_device; // what device do we think we are
-            current_device = readFirmwareVersion(); // what are we really?
-            // If we are not what we think, then update the device name           
-            if(past_device != current_device)
-            {                                
-                update = true; 
-                switch(current_device)
-                {
-                    case MICROBIT_SAMD_ID:
-                        devicePrefix="MB";
-                        whatAmI = A_MB;
-                        break;
-                    case FINCH_SAMD_ID:
-                        devicePrefix="FN";
-                        whatAmI = A_FINCH;
-                        break;
-                    case HUMMINGBIT_SAMD_ID:
-                        devicePrefix="BB";
-                        whatAmI = A_HB;
-                        initHB();
-                        break;
-                    default: // only update if you read SPI correctly
-                        update = false;
-                        break;
-                }
-                // Update the GAP name over BLE
-                if(update) {
-                    uBit.ble->stopAdvertising();
-                    fiber_sleep(10);
-                    uBit.ble->configAdvertising(devicePrefix);
-                    fiber_sleep(10);
-                    uBit.ble->advertise();
-                }
-            }
+        if(!bleConnected && deviceDetectPoll()) {
+            // Update the GAP name over BLE - swapped in place so we never stop advertising
+            ManagedString devicePrefix = setDeviceType(deviceDetectCurrent());
+            uBit.ble->updateAdvertisingName(devicePrefix);
+            updateAdvertisingState();
         }
-        fiber_sleep(1000);
+        fiber_sleep(DETECT_TICK);
     }
 }
 
@@ -95,6 +45,7 @@ main()
 
     uBit.init(); // Initializes everything but SPI
     spiInit();   // Turn on SPI
+    bootTraceMark(BOOT_PHASE_INIT);
 
     // Set the buzzer pin low so we don't accidentally energize the Finch or HB buzzer
     uBit.io.P0.setDigitalValue(0);
@@ -102,23 +53,24 @@ main()
     // Toggle the reset pin on the Finch, then hold it low
     // This happens even for HB and standalone micro:bit, as it needs to happen before we can determine device type
     uBit.io.pin[RESET_PIN].setDigitalValue(1);
-    fiber_sleep(200);
+    fiber_sleep(BOOT_RESET_PULSE);
     uBit.io.pin[RESET_PIN].setDigitalValue(0);
+    bootTraceMark(BOOT_PHASE_RESET);
     
-    // Wait for the SAMD bootloader checker
-    fiber_sleep(1850);
+    // Wait for the SAMD to come out of its bootloader and tell us what it is
+    // Get our name prefix - BB, FN, or MB - depending on what we are attached to
+    uint8_t samdId = bootIdentifySamd();
+    deviceDetectInit(samdId); // hot-plug detection starts from what we found at boot
+    ManagedString bbDevName = setDeviceType(samdId);
+    bootTraceMark(BOOT_PHASE_IDENTIFY);
 
     // Figure out what we are called, start flashing our initials
     getInitials_fancyName();
-
-    // Get our name prefix - BB, FN, or MB - depending on what we are attached to
-    ManagedString bbDevName = whichDevice(); 
-
-    // Wait for the BLE stack to stabilize before registering the UART service
-    fiber_sleep(10); 
+    bootTraceMark(BOOT_PHASE_NAMING);
 
     // Start up a UART service and start advertising
     bleSerialInit(bbDevName);     
+    bootTraceMark(BOOT_PHASE_BLE);
 
 
     // Setting up an event listener for flashing messages and for running the buzzer
@@ -128,6 +80,12 @@ main()
     create_fiber(ble_mgmt_loop);
     // Create a fiber to check if you plugged in or unplugged your micro:bit to a Finch or Hummingbird
     create_fiber(check_device_loop);
+    // Create a fiber to keep the Finch encoders and odometry up to date between sensor reports
+    create_fiber(finchSampleLoop);
+    // Create a fiber to send the in-between positions of Hummingbird servos that are easing to a new position
+    create_fiber(servoMotionLoop);
+    // Create a fiber to oversample and filter the Hummingbird sensors between sensor reports
+    create_fiber(hbSampleLoop);
     release_fiber();
     
 }
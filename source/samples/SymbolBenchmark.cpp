@@ -0,0 +1,44 @@
+#include "MicroBit.h"
+#include "Tests.h"
+#include "BirdBrain.h"
+#include "BBMicroBit.h"
+
+#define SYMBOL_BENCHMARK_FRAMES 1000
+
+// The two symbols the benchmark alternates between, a heart and an empty screen, packed as in the SYMBOL command
+static const uint8_t benchmarkSymbols[2][4] = {{0x00, 0x8A, 0xFF, 0xEE}, {0x00, 0x00, 0x00, 0x00}};
+
+// How decodeAndSetDisplay drew a symbol before it blitted into the frame buffer
+static void symbolViaImage(const uint8_t symbol[4])
+{
+    MicroBitImage bleImage(5,5);
+
+    uint32_t imageVals = ((uint32_t)symbol[0]<<24) | ((uint32_t)symbol[1]<<16) | ((uint32_t)symbol[2]<<8) | symbol[3];
+    for(int row = 0; row < 5; row++)
+    {
+        for(int col = 0; col < 5; col++)
+        {
+            bleImage.setPixelValue(row, col, (imageVals & 0x01<<(col*5+row)) ? 255 : 0);
+        }
+    }
+    uBit.display.clear();
+    uBit.display.printAsync(bleImage);
+}
+
+// Times SYMBOL_BENCHMARK_FRAMES symbols drawn each way and reports the average cost of a frame in us
+void symbol_blit_benchmark()
+{
+    uint64_t start = system_timer_current_time_us();
+    for(int i = 0; i < SYMBOL_BENCHMARK_FRAMES; i++)
+        symbolViaImage(benchmarkSymbols[i & 1]);
+    uint64_t imageTime = system_timer_current_time_us() - start;
+
+    start = system_timer_current_time_us();
+    for(int i = 0; i < SYMBOL_BENCHMARK_FRAMES; i++)
+        setDisplaySymbol(benchmarkSymbols[i & 1]);
+    uint64_t blitTime = system_timer_current_time_us() - start;
+
+    DMESG("SYMBOL: image %d.%02d us/frame, blit %d.%02d us/frame",
+        (int)(imageTime / SYMBOL_BENCHMARK_FRAMES), (int)((imageTime * 100 / SYMBOL_BENCHMARK_FRAMES) % 100),
+        (int)(blitTime / SYMBOL_BENCHMARK_FRAMES), (int)((blitTime * 100 / SYMBOL_BENCHMARK_FRAMES) % 100));
+}
@@ -20,6 +20,7 @@ void button_test4();
 void display_test1();
 void display_test2();
 void concurrent_display_test();
+void symbol_blit_benchmark();
 void fade_test();
 void mems_mic_test();
 void piezo_mic_test();